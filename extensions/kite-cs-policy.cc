@@ -0,0 +1,181 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "kite-cs-policy.h"
+#include "table/cs.hpp"
+#include "core/logger.hpp"
+
+NFD_LOG_INIT("KiteCsPolicy");
+
+namespace nfd {
+namespace cs {
+namespace kite {
+
+const std::string KitePolicy::POLICY_NAME = "kite";
+
+KitePolicy::KitePolicy()
+  : Policy(POLICY_NAME)
+  , m_protectionWindow(time::seconds(4))
+  , m_nUploadInserts(0)
+  , m_nUploadHits(0)
+  , m_nDemoted(0)
+{
+}
+
+KitePolicy::~KitePolicy()
+{
+  for (auto entryInfoMapPair : m_entryInfoMap) {
+    scheduler::cancel(entryInfoMapPair.second->demoteEventId);
+    delete entryInfoMapPair.second;
+  }
+}
+
+bool
+KitePolicy::isUploadSegment(const Name& name) const
+{
+  return std::any_of(m_uploadPrefixes.begin(), m_uploadPrefixes.end(),
+                     [&name] (const Name& prefix) { return prefix.isPrefixOf(name); });
+}
+
+void
+KitePolicy::doAfterInsert(iterator i)
+{
+  this->attachQueue(i);
+  if (m_entryInfoMap[i]->queueType == QUEUE_UPLOAD) {
+    ++m_nUploadInserts;
+  }
+  this->evictEntries();
+}
+
+void
+KitePolicy::doAfterRefresh(iterator i)
+{
+  // a refreshed upload segment was pulled again, restart its window
+  this->detachQueue(i);
+  this->attachQueue(i);
+}
+
+void
+KitePolicy::doBeforeErase(iterator i)
+{
+  this->detachQueue(i);
+}
+
+void
+KitePolicy::doBeforeUse(iterator i)
+{
+  BOOST_ASSERT(m_entryInfoMap.find(i) != m_entryInfoMap.end());
+
+  EntryInfo* entryInfo = m_entryInfoMap[i];
+  if (entryInfo->queueType == QUEUE_UPLOAD) {
+    ++m_nUploadHits;
+    NFD_LOG_INFO("CS: Upload segment served from cache: " << i->getName() << ", hits: " << m_nUploadHits);
+  }
+  else if (entryInfo->queueType == QUEUE_NORMAL) {
+    if (isUploadSegment(i->getName())) {
+      ++m_nUploadHits;
+    }
+    // LRU: move to the back of the normal queue
+    m_queues[QUEUE_NORMAL].erase(entryInfo->queueIt);
+    entryInfo->queueIt = m_queues[QUEUE_NORMAL].insert(m_queues[QUEUE_NORMAL].end(), i);
+  }
+}
+
+void
+KitePolicy::evictEntries()
+{
+  BOOST_ASSERT(this->getCs() != nullptr);
+
+  while (this->getCs()->size() > this->getLimit()) {
+    this->evictOne();
+  }
+
+  // admission: unsolicited Data does not stay
+  while (!m_queues[QUEUE_UNSOLICITED].empty()) {
+    iterator i = m_queues[QUEUE_UNSOLICITED].front();
+    this->detachQueue(i);
+    this->emitSignal(beforeEvict, i);
+  }
+}
+
+void
+KitePolicy::evictOne()
+{
+  BOOST_ASSERT(!m_queues[QUEUE_UNSOLICITED].empty() ||
+               !m_queues[QUEUE_NORMAL].empty() ||
+               !m_queues[QUEUE_UPLOAD].empty());
+
+  iterator i;
+  if (!m_queues[QUEUE_UNSOLICITED].empty()) {
+    i = m_queues[QUEUE_UNSOLICITED].front();
+  }
+  else if (!m_queues[QUEUE_NORMAL].empty()) {
+    i = m_queues[QUEUE_NORMAL].front();
+  }
+  else {
+    i = m_queues[QUEUE_UPLOAD].front();
+  }
+
+  this->detachQueue(i);
+  this->emitSignal(beforeEvict, i);
+}
+
+void
+KitePolicy::attachQueue(iterator i)
+{
+  BOOST_ASSERT(m_entryInfoMap.find(i) == m_entryInfoMap.end());
+
+  EntryInfo* entryInfo = new EntryInfo();
+  if (i->isUnsolicited()) {
+    entryInfo->queueType = QUEUE_UNSOLICITED;
+  }
+  else if (isUploadSegment(i->getName())) {
+    entryInfo->queueType = QUEUE_UPLOAD;
+    entryInfo->demoteEventId = scheduler::schedule(m_protectionWindow,
+                                                   bind(&KitePolicy::moveToNormalQueue, this, i));
+  }
+  else {
+    entryInfo->queueType = QUEUE_NORMAL;
+  }
+
+  Queue& queue = m_queues[entryInfo->queueType];
+  entryInfo->queueIt = queue.insert(queue.end(), i);
+  m_entryInfoMap[i] = entryInfo;
+}
+
+void
+KitePolicy::detachQueue(iterator i)
+{
+  BOOST_ASSERT(m_entryInfoMap.find(i) != m_entryInfoMap.end());
+
+  EntryInfo* entryInfo = m_entryInfoMap[i];
+  if (entryInfo->queueType == QUEUE_UPLOAD) {
+    scheduler::cancel(entryInfo->demoteEventId);
+  }
+
+  m_queues[entryInfo->queueType].erase(entryInfo->queueIt);
+  m_entryInfoMap.erase(i);
+  delete entryInfo;
+}
+
+void
+KitePolicy::moveToNormalQueue(iterator i)
+{
+  BOOST_ASSERT(m_entryInfoMap.find(i) != m_entryInfoMap.end());
+
+  EntryInfo* entryInfo = m_entryInfoMap[i];
+  BOOST_ASSERT(entryInfo->queueType == QUEUE_UPLOAD);
+
+  m_queues[QUEUE_UPLOAD].erase(entryInfo->queueIt);
+  entryInfo->queueType = QUEUE_NORMAL;
+  entryInfo->queueIt = m_queues[QUEUE_NORMAL].insert(m_queues[QUEUE_NORMAL].end(), i);
+  ++m_nDemoted;
+}
+
+} // namespace kite
+} // namespace cs
+} // namespace nfd
@@ -0,0 +1,173 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NFD_DAEMON_TABLE_KITE_CS_POLICY_HPP
+#define NFD_DAEMON_TABLE_KITE_CS_POLICY_HPP
+
+#include "table/cs-policy.hpp"
+#include "core/scheduler.hpp"
+
+#include <list>
+
+namespace nfd {
+namespace cs {
+namespace kite {
+
+typedef std::list<iterator> Queue;
+
+enum QueueType {
+  QUEUE_UNSOLICITED,
+  QUEUE_NORMAL,
+  QUEUE_UPLOAD,
+  QUEUE_MAX
+};
+
+struct EntryInfo
+{
+  QueueType queueType;
+  Queue::iterator queueIt;
+  scheduler::EventId demoteEventId;
+};
+
+struct EntryItComparator
+{
+  bool
+  operator()(const iterator& a, const iterator& b) const
+  {
+    return *a < *b;
+  }
+};
+
+typedef std::map<iterator, EntryInfo*, EntryItComparator> EntryInfoMap;
+
+/** \brief Kite-aware admission and replacement policy
+ *
+ *  Data under one of the upload prefixes was pulled from a mobile by tracing Interests.
+ *  Such upload segments are kept in a protected queue for a configurable window after
+ *  insertion, so that retransmitted pulls after a handover are answered by the routers
+ *  on the trace path instead of crossing the wireless link again.
+ *  After the window they are demoted to the normal LRU queue.
+ *
+ *  Unsolicited Data is not admitted.
+ *  Eviction order: unsolicited, then normal (least recently used first),
+ *  then protected upload segments (oldest first).
+ */
+class KitePolicy : public Policy
+{
+public:
+  KitePolicy();
+
+  virtual
+  ~KitePolicy();
+
+  /** \brief treats Data under \p prefix as upload segments
+   */
+  void
+  addUploadPrefix(const Name& prefix)
+  {
+    m_uploadPrefixes.push_back(prefix);
+  }
+
+  /** \brief sets how long upload segments are protected after insertion
+   */
+  void
+  setProtectionWindow(const time::nanoseconds& window)
+  {
+    m_protectionWindow = window;
+  }
+
+public: // counters
+  /** \return number of upload segments admitted
+   */
+  uint64_t
+  getUploadInsertCount() const
+  {
+    return m_nUploadInserts;
+  }
+
+  /** \return number of cache hits on upload segments, i.e., retransmitted pulls served by this node
+   */
+  uint64_t
+  getUploadHitCount() const
+  {
+    return m_nUploadHits;
+  }
+
+  /** \return number of upload segments that left the protected queue after the window
+   */
+  uint64_t
+  getDemotedCount() const
+  {
+    return m_nDemoted;
+  }
+
+public:
+  static const std::string POLICY_NAME;
+
+private:
+  virtual void
+  doAfterInsert(iterator i) override;
+
+  virtual void
+  doAfterRefresh(iterator i) override;
+
+  virtual void
+  doBeforeErase(iterator i) override;
+
+  virtual void
+  doBeforeUse(iterator i) override;
+
+  virtual void
+  evictEntries() override;
+
+private:
+  bool
+  isUploadSegment(const Name& name) const;
+
+  /** \brief evicts one entry
+   *  \pre CS is not empty
+   */
+  void
+  evictOne();
+
+  /** \brief attaches the entry to an appropriate queue
+   *  \pre the entry is not in any queue
+   */
+  void
+  attachQueue(iterator i);
+
+  /** \brief detaches the entry from its current queue
+   *  \post the entry is not in any queue
+   */
+  void
+  detachQueue(iterator i);
+
+  /** \brief moves an upload segment from the protected queue to the normal queue
+   */
+  void
+  moveToNormalQueue(iterator i);
+
+private:
+  Queue m_queues[QUEUE_MAX];
+  EntryInfoMap m_entryInfoMap;
+
+  std::vector<Name> m_uploadPrefixes;
+  time::nanoseconds m_protectionWindow;
+
+  uint64_t m_nUploadInserts;
+  uint64_t m_nUploadHits;
+  uint64_t m_nDemoted;
+};
+
+} // namespace kite
+
+using kite::KitePolicy;
+
+} // namespace cs
+} // namespace nfd
+
+#endif // NFD_DAEMON_TABLE_KITE_CS_POLICY_HPP
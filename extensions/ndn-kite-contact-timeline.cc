@@ -0,0 +1,333 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-contact-timeline.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/pointer.h"
+#include "ns3/abort.h"
+
+#include "ns3/ndnSIM/model/ndn-l3-protocol.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteContactTimeline");
+
+namespace ns3 {
+namespace ndn {
+
+namespace {
+
+const double EPSILON = 1e-9; // seconds
+
+uint64_t
+makeCell(int64_t x, int64_t y)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+bool
+isEarlier(const KiteContactTimeline::Contact& a, const KiteContactTimeline::Contact& b)
+{
+  return a.start < b.start;
+}
+
+} // anonymous namespace
+
+KiteContactTimeline::KiteContactTimeline()
+  : m_range(0)
+{
+}
+
+void
+KiteContactTimeline::SetAccessRouters(const NodeContainer& accessRouters, double range)
+{
+  NS_ABORT_MSG_IF(range <= 0, "Contact range must be positive");
+  m_range = range;
+  m_accessPositions.clear();
+  m_accessCells.clear();
+
+  // cells as wide as the range, so a point only meets access routers of the 3 x 3 cells around it
+  for (uint32_t i = 0; i < accessRouters.GetN(); ++i) {
+    Ptr<MobilityModel> mobility = accessRouters.Get(i)->GetObject<MobilityModel>();
+    NS_ABORT_MSG_IF(mobility == nullptr, "Access routers need a position");
+    Vector position = mobility->GetPosition();
+    m_accessPositions.push_back(position);
+    m_accessCells[makeCell(std::floor(position.x / m_range), std::floor(position.y / m_range))].push_back(i);
+  }
+}
+
+void
+KiteContactTimeline::Record(const NodeContainer& mobiles)
+{
+  m_hasSegment.assign(mobiles.GetN(), false);
+  m_segments.assign(mobiles.GetN(), Segment());
+  m_openContacts.assign(mobiles.GetN(), std::map<uint32_t, OpenContact>());
+
+  for (uint32_t i = 0; i < mobiles.GetN(); ++i) {
+    Ptr<MobilityModel> mobility = mobiles.Get(i)->GetObject<MobilityModel>();
+    NS_ABORT_MSG_IF(mobility == nullptr, "Mobiles need a mobility model");
+    mobility->TraceConnect("CourseChange", std::to_string(i), MakeCallback(&KiteContactTimeline::OnCourseChange, this));
+    OnCourseChange(std::to_string(i), mobility);
+  }
+}
+
+void
+KiteContactTimeline::OnCourseChange(std::string context, Ptr<const MobilityModel> model)
+{
+  uint32_t mobile = std::stoul(context);
+  double now = Simulator::Now().GetSeconds();
+  if (m_hasSegment[mobile]) {
+    CloseSegment(mobile, m_segments[mobile], now);
+  }
+  m_segments[mobile] = {now, model->GetPosition(), model->GetVelocity()};
+  m_hasSegment[mobile] = true;
+}
+
+void
+KiteContactTimeline::CloseSegment(uint32_t mobile, const Segment& segment, double end)
+{
+  double duration = std::max(end - segment.start, 0.0);
+  const Vector& p = segment.position;
+  const Vector& v = segment.velocity;
+
+  // access routers near the bounding box of the segment
+  int64_t xMin = std::floor((std::min(p.x, p.x + v.x * duration) - m_range) / m_range);
+  int64_t xMax = std::floor((std::max(p.x, p.x + v.x * duration) + m_range) / m_range);
+  int64_t yMin = std::floor((std::min(p.y, p.y + v.y * duration) - m_range) / m_range);
+  int64_t yMax = std::floor((std::max(p.y, p.y + v.y * duration) + m_range) / m_range);
+
+  std::map<uint32_t, OpenContact> found;
+  for (int64_t x = xMin; x <= xMax; ++x) {
+    for (int64_t y = yMin; y <= yMax; ++y) {
+      auto cell = m_accessCells.find(makeCell(x, y));
+      if (cell == m_accessCells.end()) {
+        continue;
+      }
+      for (uint32_t accessRouter : cell->second) {
+        // |p - r + v t|^2 <= range^2 for t in [0, duration]
+        double dx = p.x - m_accessPositions[accessRouter].x;
+        double dy = p.y - m_accessPositions[accessRouter].y;
+        double a = v.x * v.x + v.y * v.y;
+        double b = 2 * (dx * v.x + dy * v.y);
+        double c = dx * dx + dy * dy - m_range * m_range;
+        double in = 0;
+        double out = duration;
+        if (a == 0) {
+          if (c > 0) {
+            continue;
+          }
+        }
+        else {
+          double discriminant = b * b - 4 * a * c;
+          if (discriminant < 0) {
+            continue;
+          }
+          in = std::max((-b - std::sqrt(discriminant)) / (2 * a), 0.0);
+          out = std::min((-b + std::sqrt(discriminant)) / (2 * a), duration);
+          if (in > out) {
+            continue;
+          }
+        }
+        found[accessRouter] = {segment.start + in, segment.start + out};
+      }
+    }
+  }
+
+  // contacts running on from the previous segment are extended, others are opened
+  std::map<uint32_t, OpenContact>& open = m_openContacts[mobile];
+  for (const auto& contact : found) {
+    auto it = open.find(contact.first);
+    if (it != open.end() && contact.second.start <= it->second.end + EPSILON) {
+      it->second.end = std::max(it->second.end, contact.second.end);
+      continue;
+    }
+    if (it != open.end() && it->second.end - it->second.start > EPSILON) {
+      m_contacts.push_back({mobile, it->first, it->second.start, it->second.end});
+    }
+    open[contact.first] = contact.second;
+  }
+
+  // those over before the end of the segment cannot go on
+  for (auto it = open.begin(); it != open.end();) {
+    if (it->second.end < end - EPSILON) {
+      if (it->second.end - it->second.start > EPSILON) {
+        m_contacts.push_back({mobile, it->first, it->second.start, it->second.end});
+      }
+      it = open.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+void
+KiteContactTimeline::Finish(Time end)
+{
+  for (uint32_t mobile = 0; mobile < m_segments.size(); ++mobile) {
+    if (m_hasSegment[mobile]) {
+      CloseSegment(mobile, m_segments[mobile], end.GetSeconds());
+      m_hasSegment[mobile] = false;
+    }
+    for (const auto& contact : m_openContacts[mobile]) {
+      if (contact.second.end - contact.second.start > EPSILON) {
+        m_contacts.push_back({mobile, contact.first, contact.second.start, contact.second.end});
+      }
+    }
+    m_openContacts[mobile].clear();
+  }
+  std::stable_sort(m_contacts.begin(), m_contacts.end(), &isEarlier);
+
+  NS_LOG_INFO(m_contacts.size() << " contacts of " << m_segments.size() << " mobiles with "
+              << m_accessPositions.size() << " access routers");
+}
+
+void
+KiteContactTimeline::Save(const std::string& filename) const
+{
+  std::ofstream os(filename);
+  if (!os) {
+    NS_FATAL_ERROR("Cannot open contact file " << filename);
+  }
+  os << "# mobile accessRouter start end\n" << std::setprecision(12);
+  for (const Contact& contact : m_contacts) {
+    os << contact.mobile << ' ' << contact.accessRouter << ' ' << contact.start << ' ' << contact.end << '\n';
+  }
+}
+
+void
+KiteContactTimeline::Load(const std::string& filename)
+{
+  std::ifstream is(filename);
+  if (!is) {
+    NS_FATAL_ERROR("Cannot open contact file " << filename);
+  }
+
+  m_contacts.clear();
+  std::string line;
+  while (std::getline(is, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream ls(line);
+    Contact contact;
+    if (!(ls >> contact.mobile >> contact.accessRouter >> contact.start >> contact.end)) {
+      NS_FATAL_ERROR("Malformed contact: " << line);
+    }
+    m_contacts.push_back(contact);
+  }
+  std::stable_sort(m_contacts.begin(), m_contacts.end(), &isEarlier);
+}
+
+void
+KiteContactTimeline::InstallLinks(const NodeContainer& mobiles, const NodeContainer& accessRouters,
+                                  const PointToPointHelper& p2p, StackHelper::FaceCreateCallback createFace,
+                                  LinkCallback onLinkChange)
+{
+  m_mobiles = mobiles;
+  m_accessRouters = accessRouters;
+  m_p2p = p2p;
+  m_createFace = createFace;
+  m_onLinkChange = onLinkChange;
+  m_nextContact = 0;
+  ScheduleNextContact();
+}
+
+void
+KiteContactTimeline::ScheduleNextContact()
+{
+  // contacts are in start order, so only the next one has to wait in the event queue
+  while (m_nextContact < m_contacts.size()) {
+    const Contact& contact = m_contacts[m_nextContact];
+    if (contact.mobile >= m_mobiles.GetN() || contact.accessRouter >= m_accessRouters.GetN()) {
+      NS_LOG_WARN("Skipping contact of mobile " << contact.mobile << " with access router " << contact.accessRouter);
+      m_nextContact++;
+      continue;
+    }
+    Time delay = std::max(Seconds(contact.start) - Simulator::Now(), Seconds(0));
+    Simulator::Schedule(delay, &KiteContactTimeline::StartContact, this, m_nextContact++);
+    return;
+  }
+}
+
+void
+KiteContactTimeline::StartContact(uint32_t index)
+{
+  const Contact& contact = m_contacts[index];
+  Link& link = GetLink(contact.mobile, contact.accessRouter);
+  if (link.nContacts++ == 0) {
+    SetLinkUp(contact.mobile, contact.accessRouter, link, true);
+  }
+  Simulator::Schedule(Seconds(contact.end - contact.start), &KiteContactTimeline::EndContact, this,
+                      contact.mobile, contact.accessRouter);
+
+  ScheduleNextContact();
+}
+
+void
+KiteContactTimeline::EndContact(uint32_t mobile, uint32_t accessRouter)
+{
+  Link& link = m_links[std::make_pair(mobile, accessRouter)];
+  if (--link.nContacts == 0) {
+    SetLinkUp(mobile, accessRouter, link, false);
+  }
+}
+
+KiteContactTimeline::Link&
+KiteContactTimeline::GetLink(uint32_t mobile, uint32_t accessRouter)
+{
+  auto it = m_links.find(std::make_pair(mobile, accessRouter));
+  if (it != m_links.end()) {
+    return it->second;
+  }
+
+  Link& link = m_links[std::make_pair(mobile, accessRouter)];
+  link.nContacts = 0;
+
+  // down by default: the receiving ends drop every packet until a contact begins
+  NetDeviceContainer devices = m_p2p.Install(m_mobiles.Get(mobile), m_accessRouters.Get(accessRouter));
+  for (uint32_t i = 0; i < devices.GetN(); ++i) {
+    Ptr<RateErrorModel> errorModel = CreateObject<RateErrorModel>();
+    errorModel->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+    errorModel->SetRate(1.0);
+    devices.Get(i)->SetAttribute("ReceiveErrorModel", PointerValue(errorModel));
+    link.errorModels[i] = errorModel;
+
+    Ptr<Node> node = devices.Get(i)->GetNode();
+    link.faces[i] = m_createFace(node, node->GetObject<L3Protocol>(), devices.Get(i));
+  }
+
+  NS_LOG_INFO("Contact link " << m_links.size() << " between mobile " << mobile
+              << " and access router " << accessRouter);
+  return link;
+}
+
+void
+KiteContactTimeline::SetLinkUp(uint32_t mobile, uint32_t accessRouter, Link& link, bool isUp)
+{
+  for (const Ptr<ErrorModel>& errorModel : link.errorModels) {
+    if (isUp) {
+      errorModel->Disable();
+    }
+    else {
+      errorModel->Enable();
+    }
+  }
+
+  if (!m_onLinkChange.IsNull()) {
+    m_onLinkChange(mobile, accessRouter, link.faces[0], link.faces[1], isUp);
+  }
+}
+
+} // namespace ndn
+} // namespace ns3
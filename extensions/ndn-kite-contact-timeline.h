@@ -0,0 +1,198 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_CONTACT_TIMELINE_H
+#define NDN_KITE_CONTACT_TIMELINE_H
+
+#include "ns3/callback.h"
+#include "ns3/error-model.h"
+#include "ns3/mobility-model.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/vector.h"
+
+#include "ns3/ndnSIM/helper/ndn-stack-helper.hpp"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief When each mobile is in range of each access router, computed once and replayed as link up/down events
+ *
+ * Recording follows the CourseChange of the mobiles while only mobility is simulated. Between two course
+ * changes a mobile moves in a straight line, so its contacts with the access routers are solved exactly
+ * rather than sampled.
+ *
+ * Replaying links a mobile to an access router with a point-to-point link, faces included, at their first
+ * contact. A link is up during its contacts and drops everything otherwise, so handovers need no wireless
+ * simulation. Links are only created for the pairs that met so far and only the next contact waits in
+ * the event queue, so neither grows with the length of the timeline. The scenario is told whenever a link
+ * comes up or goes down, to route over the links that are up only.
+ *
+ *     // tool: mobility only
+ *     ndn::KiteContactTimeline timeline;
+ *     timeline.SetAccessRouters(accessRouters, 30);
+ *     timeline.Record(mobiles);
+ *     Simulator::Run();
+ *     timeline.Finish(Simulator::Now());
+ *     timeline.Save("contacts.txt");
+ *
+ *     // scenario, once the NDN stack is installed
+ *     timeline.Load("contacts.txt");
+ *     timeline.InstallLinks(mobiles, accessRouters, p2p, MakeCallback(&ndn::KitePointToPointFaceCallback),
+ *                           MakeCallback(&OnLinkChange));
+ */
+class KiteContactTimeline {
+public:
+  struct Contact
+  {
+    uint32_t mobile;       // index in the mobile container
+    uint32_t accessRouter; // index in the access router container
+    double start;          // seconds
+    double end;            // seconds
+  };
+
+  /**
+   * @brief Called with the mobile and access router indices, their faces on the link, and whether it is up
+   */
+  typedef Callback<void, uint32_t, uint32_t, shared_ptr<Face>, shared_ptr<Face>, bool> LinkCallback;
+
+  KiteContactTimeline();
+
+  /**
+   * @param accessRouters nodes with a mobility model, their position is read once
+   * @param range distance in meters within which a mobile is in contact
+   */
+  void
+  SetAccessRouters(const NodeContainer& accessRouters, double range);
+
+  /**
+   * @brief Starts following the course changes of @p mobiles
+   */
+  void
+  Record(const NodeContainer& mobiles);
+
+  /**
+   * @brief Closes the contacts still open at @p end
+   */
+  void
+  Finish(Time end);
+
+  const std::vector<Contact>&
+  GetContacts() const
+  {
+    return m_contacts;
+  }
+
+  /**
+   * @brief Number of links created so far, one per pair that met
+   */
+  size_t
+  GetLinkCount() const
+  {
+    return m_links.size();
+  }
+
+  /**
+   * @brief Writes "mobile accessRouter start end" lines, in start order
+   */
+  void
+  Save(const std::string& filename) const;
+
+  void
+  Load(const std::string& filename);
+
+  /**
+   * @brief Starts replaying the contacts as link up/down, creating each link at the first contact of its pair
+   *
+   * @param createFace creates the faces on both ends of a new link
+   * @param onLinkChange called whenever a link comes up or goes down
+   */
+  void
+  InstallLinks(const NodeContainer& mobiles, const NodeContainer& accessRouters, const PointToPointHelper& p2p,
+               StackHelper::FaceCreateCallback createFace, LinkCallback onLinkChange);
+
+private:
+  struct Segment
+  {
+    double start;
+    Vector position;
+    Vector velocity;
+  };
+
+  struct OpenContact
+  {
+    double start;
+    double end;
+  };
+
+  void
+  OnCourseChange(std::string context, Ptr<const MobilityModel> model);
+
+  /**
+   * @brief Adds the contacts of @p mobile while moving along @p segment until @p end
+   */
+  void
+  CloseSegment(uint32_t mobile, const Segment& segment, double end);
+
+  struct Link
+  {
+    Ptr<ErrorModel> errorModels[2]; // mobile side, access router side
+    shared_ptr<Face> faces[2];
+    uint32_t nContacts;             // going on now
+  };
+
+  /**
+   * @brief Schedules the start of the next contact, skipping those of unknown nodes
+   */
+  void
+  ScheduleNextContact();
+
+  void
+  StartContact(uint32_t index);
+
+  void
+  EndContact(uint32_t mobile, uint32_t accessRouter);
+
+  /**
+   * @brief Creates the link of a pair and its faces, down
+   */
+  Link&
+  GetLink(uint32_t mobile, uint32_t accessRouter);
+
+  void
+  SetLinkUp(uint32_t mobile, uint32_t accessRouter, Link& link, bool isUp);
+
+private:
+  double m_range;
+  std::vector<Vector> m_accessPositions;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_accessCells; // access router indices by cell
+
+  std::vector<bool> m_hasSegment;                              // by mobile
+  std::vector<Segment> m_segments;                             // current one, by mobile
+  std::vector<std::map<uint32_t, OpenContact>> m_openContacts; // by mobile, then access router
+  std::vector<Contact> m_contacts;
+
+  NodeContainer m_mobiles;
+  NodeContainer m_accessRouters;
+  PointToPointHelper m_p2p;
+  StackHelper::FaceCreateCallback m_createFace;
+  LinkCallback m_onLinkChange;
+  uint32_t m_nextContact;                                    // index of the next contact to schedule
+  std::map<std::pair<uint32_t, uint32_t>, Link> m_links;     // by mobile and access router
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_CONTACT_TIMELINE_H
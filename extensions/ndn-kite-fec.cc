@@ -0,0 +1,183 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-fec.h"
+
+#include "ns3/assert.h"
+
+#include <algorithm>
+
+namespace ns3 {
+namespace ndn {
+
+namespace {
+
+/**
+ * @brief log/exp tables of GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1
+ */
+struct GfTables
+{
+  uint8_t exp[512];
+  uint8_t log[256];
+
+  GfTables()
+  {
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++) {
+      exp[i] = static_cast<uint8_t>(x);
+      log[x] = static_cast<uint8_t>(i);
+      x <<= 1;
+      if (x & 0x100) {
+        x ^= 0x11d;
+      }
+    }
+    for (int i = 255; i < 512; i++) {
+      exp[i] = exp[i - 255];
+    }
+    log[0] = 0; // never used
+  }
+};
+
+const GfTables&
+getGfTables()
+{
+  static const GfTables tables;
+  return tables;
+}
+
+} // anonymous namespace
+
+KiteFecCoder::KiteFecCoder(uint32_t k, uint32_t n)
+  : m_k(k)
+  , m_n(n)
+{
+  NS_ASSERT_MSG(k > 0 && k <= n && n <= 256, "FEC needs 0 < k <= n <= 256");
+}
+
+uint8_t
+KiteFecCoder::Multiply(uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  const GfTables& gf = getGfTables();
+  return gf.exp[gf.log[a] + gf.log[b]];
+}
+
+uint8_t
+KiteFecCoder::Inverse(uint8_t a)
+{
+  NS_ASSERT(a != 0);
+  const GfTables& gf = getGfTables();
+  return gf.exp[255 - gf.log[a]];
+}
+
+void
+KiteFecCoder::AddScaled(Symbol& dst, const Symbol& src, uint8_t c)
+{
+  if (c == 0) {
+    return;
+  }
+
+  const GfTables& gf = getGfTables();
+  int logC = gf.log[c];
+  size_t size = std::min(dst.size(), src.size());
+  for (size_t i = 0; i < size; i++) {
+    if (src[i] != 0) {
+      dst[i] ^= gf.exp[gf.log[src[i]] + logC];
+    }
+  }
+}
+
+uint8_t
+KiteFecCoder::GetCoefficient(uint32_t index, uint32_t column) const
+{
+  if (index < m_k) {
+    return index == column ? 1 : 0;
+  }
+  // Cauchy row: 1 / (x_i + y_j) with x_i = index, y_j = column, never equal since index >= k > column
+  return Inverse(static_cast<uint8_t>(index ^ column));
+}
+
+KiteFecCoder::Symbol
+KiteFecCoder::Encode(const std::vector<Symbol>& source, uint32_t index) const
+{
+  NS_ASSERT(source.size() == m_k && index < m_n);
+
+  if (index < m_k) {
+    return source[index];
+  }
+
+  Symbol coded(source[0].size(), 0);
+  for (uint32_t j = 0; j < m_k; j++) {
+    AddScaled(coded, source[j], GetCoefficient(index, j));
+  }
+  return coded;
+}
+
+bool
+KiteFecCoder::Decode(const std::map<uint32_t, Symbol>& symbols, std::vector<Symbol>& source) const
+{
+  if (symbols.size() < m_k) {
+    return false;
+  }
+
+  // take the first k symbols, source ones first since their rows are already reduced
+  std::vector<std::vector<uint8_t>> matrix;
+  std::vector<Symbol> rows;
+  for (const auto& symbol : symbols) {
+    if (rows.size() == m_k) {
+      break;
+    }
+    std::vector<uint8_t> coefficients(m_k);
+    for (uint32_t j = 0; j < m_k; j++) {
+      coefficients[j] = GetCoefficient(symbol.first, j);
+    }
+    matrix.push_back(std::move(coefficients));
+    rows.push_back(symbol.second);
+  }
+
+  // Gauss-Jordan elimination, any k rows of [I; Cauchy] are independent
+  for (uint32_t col = 0; col < m_k; col++) {
+    uint32_t pivot = col;
+    while (pivot < m_k && matrix[pivot][col] == 0) {
+      pivot++;
+    }
+    if (pivot == m_k) {
+      return false;
+    }
+    std::swap(matrix[pivot], matrix[col]);
+    std::swap(rows[pivot], rows[col]);
+
+    uint8_t inverse = Inverse(matrix[col][col]);
+    if (inverse != 1) {
+      for (uint32_t j = 0; j < m_k; j++) {
+        matrix[col][j] = Multiply(matrix[col][j], inverse);
+      }
+      Symbol scaled(rows[col].size(), 0);
+      AddScaled(scaled, rows[col], inverse);
+      rows[col].swap(scaled);
+    }
+
+    for (uint32_t r = 0; r < m_k; r++) {
+      uint8_t factor = matrix[r][col];
+      if (r == col || factor == 0) {
+        continue;
+      }
+      for (uint32_t j = 0; j < m_k; j++) {
+        matrix[r][j] ^= Multiply(factor, matrix[col][j]);
+      }
+      AddScaled(rows[r], rows[col], factor);
+    }
+  }
+
+  source.swap(rows);
+  return true;
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,80 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_FEC_H
+#define NDN_KITE_FEC_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Systematic Reed-Solomon erasure code over GF(2^8) for groups of upload segments
+ *
+ * A group holds k source symbols of equal size and up to n coded symbols (n <= 256).
+ * Symbols 0..k-1 are the source symbols themselves, symbol i >= k is a Cauchy combination of them,
+ * so any k distinct symbols of a group reconstruct it.
+ */
+class KiteFecCoder {
+public:
+  typedef std::vector<uint8_t> Symbol;
+
+  KiteFecCoder(uint32_t k, uint32_t n);
+
+  uint32_t
+  GetK() const
+  {
+    return m_k;
+  }
+
+  uint32_t
+  GetN() const
+  {
+    return m_n;
+  }
+
+  /**
+   * @brief Computes coded symbol @p index of a group from its k source symbols
+   */
+  Symbol
+  Encode(const std::vector<Symbol>& source, uint32_t index) const;
+
+  /**
+   * @brief Reconstructs the k source symbols of a group from any k of its symbols, keyed by index
+   * @return false if fewer than k symbols are given
+   */
+  bool
+  Decode(const std::map<uint32_t, Symbol>& symbols, std::vector<Symbol>& source) const;
+
+private:
+  uint8_t
+  GetCoefficient(uint32_t index, uint32_t column) const;
+
+  static uint8_t
+  Multiply(uint8_t a, uint8_t b);
+
+  static uint8_t
+  Inverse(uint8_t a);
+
+  /**
+   * @brief dst ^= c * src
+   */
+  static void
+  AddScaled(Symbol& dst, const Symbol& src, uint8_t c);
+
+private:
+  uint32_t m_k;
+  uint32_t m_n;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_FEC_H
@@ -0,0 +1,93 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-metrics.h"
+
+#include "ns3/fatal-error.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace ns3 {
+namespace ndn {
+
+void
+KiteMetrics::Set(const std::string& name, double value)
+{
+  if (!std::isfinite(value)) {
+    SetJson(name, "null");
+    return;
+  }
+  std::ostringstream os;
+  os.precision(12);
+  os << value;
+  SetJson(name, os.str());
+}
+
+void
+KiteMetrics::Set(const std::string& name, const std::string& value)
+{
+  SetJson(name, Quote(value));
+}
+
+void
+KiteMetrics::SetJson(const std::string& name, const std::string& json)
+{
+  for (auto& value : m_values) {
+    if (value.first == name) {
+      value.second = json;
+      return;
+    }
+  }
+  m_values.emplace_back(name, json);
+}
+
+std::string
+KiteMetrics::Quote(const std::string& s)
+{
+  std::string quoted = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    }
+    else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+void
+KiteMetrics::Save(const std::string& filename) const
+{
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream os(tmp);
+    if (!os) {
+      NS_FATAL_ERROR("Cannot open metrics file " << tmp);
+    }
+    os << "{";
+    for (size_t i = 0; i < m_values.size(); ++i) {
+      os << (i == 0 ? "\n  " : ",\n  ") << Quote(m_values[i].first) << ": " << m_values[i].second;
+    }
+    os << "\n}\n";
+  }
+  if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+    NS_FATAL_ERROR("Cannot rename " << tmp << " to " << filename);
+  }
+}
+
+} // namespace ndn
+} // namespace ns3
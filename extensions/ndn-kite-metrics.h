@@ -0,0 +1,58 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_METRICS_H
+#define NDN_KITE_METRICS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Named results of one scenario run, saved as a JSON object for run.py to aggregate
+ *
+ * Values are kept in the order they are first set. run.py only aggregates numbers, values set with
+ * SetJson() are for other tools. The file only appears once it is complete,
+ * so run.py takes its presence as the mark of a finished run.
+ */
+class KiteMetrics {
+public:
+  void
+  Set(const std::string& name, double value);
+
+  void
+  Set(const std::string& name, const std::string& value);
+
+  /**
+   * @brief Sets a value that is already JSON, such as an array or an object
+   */
+  void
+  SetJson(const std::string& name, const std::string& json);
+
+  /**
+   * @brief Writes @p filename.tmp, then renames it to @p filename
+   */
+  void
+  Save(const std::string& filename) const;
+
+  /**
+   * @brief @p s as a JSON string
+   */
+  static std::string
+  Quote(const std::string& s);
+
+private:
+  std::vector<std::pair<std::string, std::string>> m_values; // name, JSON literal
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_METRICS_H
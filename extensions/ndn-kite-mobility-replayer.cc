@@ -0,0 +1,226 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-mobility-replayer.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/constant-velocity-mobility-model.h"
+
+#include <algorithm>
+#include <cstdio>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteMobilityReplayer");
+
+namespace ns3 {
+namespace ndn {
+
+NS_OBJECT_ENSURE_REGISTERED(KiteMobilityReplayer);
+
+TypeId
+KiteMobilityReplayer::GetTypeId()
+{
+  static TypeId tid =
+    TypeId("ns3::ndn::KiteMobilityReplayer")
+      .SetGroupName("Ndn")
+      .SetParent<Object>()
+      .AddConstructor<KiteMobilityReplayer>()
+
+      .AddAttribute("LookAhead", "How far ahead of the simulation time the trace is read", StringValue("1s"),
+                    MakeTimeAccessor(&KiteMobilityReplayer::m_lookAhead), MakeTimeChecker());
+
+  return tid;
+}
+
+KiteMobilityReplayer::KiteMobilityReplayer()
+  : m_hasNext(false)
+  , m_nPending(0)
+  , m_maxPending(0)
+  , m_nReplayed(0)
+  , m_nLate(0)
+  , m_nSkipped(0)
+{
+}
+
+KiteMobilityReplayer::~KiteMobilityReplayer()
+{
+}
+
+void
+KiteMobilityReplayer::DoDispose()
+{
+  m_readEvent.Cancel();
+  for (EventId& arrival : m_arrivals) {
+    arrival.Cancel();
+  }
+  m_arrivals.clear();
+  m_is.close();
+  m_nodes = NodeContainer();
+
+  Object::DoDispose();
+}
+
+void
+KiteMobilityReplayer::Install(const std::string& filename, const NodeContainer& nodes)
+{
+  if (!std::ifstream(filename)) {
+    NS_FATAL_ERROR("Cannot open mobility trace " << filename);
+  }
+
+  m_filename = filename;
+  m_nodes = nodes;
+  m_arrivals.assign(nodes.GetN(), EventId());
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel("ns3::ConstantVelocityMobilityModel");
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr<MobilityModel> model = nodes.Get(i)->GetObject<MobilityModel>();
+    if (model == nullptr) {
+      mobility.Install(nodes.Get(i));
+    }
+    else if (DynamicCast<ConstantVelocityMobilityModel>(model) == nullptr) {
+      NS_FATAL_ERROR("Node " << nodes.Get(i)->GetId() << " already has a mobility model, cannot replay onto it");
+    }
+  }
+
+  // read nothing before the run: replicas forked in between would share the file offset
+  m_readEvent = Simulator::ScheduleNow(&KiteMobilityReplayer::Open, this);
+}
+
+void
+KiteMobilityReplayer::Open()
+{
+  m_is.open(m_filename);
+  if (!m_is) {
+    NS_FATAL_ERROR("Cannot open mobility trace " << m_filename);
+  }
+
+  m_hasNext = ReadNext();
+  ReadAhead();
+}
+
+bool
+KiteMobilityReplayer::ReadNext()
+{
+  std::string line;
+  while (std::getline(m_is, line)) {
+    CourseChange& change = m_next;
+    double time = 0;
+    char axis = 0;
+    double value = 0;
+    double speed = 0;
+
+    // sscanf rather than streams, traces run to millions of lines
+    if (std::sscanf(line.c_str(), "now=%lfns node=%u pos=%lf:%lf:%lf vel=%lf:%lf:%lf", &time, &change.node,
+                    &change.position.x, &change.position.y, &change.position.z,
+                    &change.velocity.x, &change.velocity.y, &change.velocity.z) == 8) {
+      change.time = Time::FromDouble(time, Time::NS);
+      change.kind = CourseChange::STATE;
+    }
+    else if (std::sscanf(line.c_str(), " $ns_ at %lf \"$node_(%u) setdest %lf %lf %lf", &time, &change.node,
+                         &change.position.x, &change.position.y, &speed) == 5) {
+      change.time = Seconds(time);
+      change.kind = CourseChange::DESTINATION;
+      change.velocity = Vector(speed, 0, 0);
+    }
+    else if (std::sscanf(line.c_str(), " $node_(%u) set %c_ %lf", &change.node, &axis, &value) == 3
+             && (axis == 'X' || axis == 'Y' || axis == 'Z')) {
+      change.time = Seconds(0);
+      change.kind = CourseChange::COORDINATE;
+      change.velocity = Vector(axis - 'X', value, 0);
+    }
+    else {
+      continue; // comments and commands other than movements
+    }
+
+    if (change.node >= m_nodes.GetN()) {
+      m_nSkipped++;
+      continue;
+    }
+    return true;
+  }
+  return false;
+}
+
+void
+KiteMobilityReplayer::ReadAhead()
+{
+  Time now = Simulator::Now();
+  Time horizon = now + m_lookAhead;
+  while (m_hasNext && m_next.time <= horizon) {
+    Time delay = m_next.time - now;
+    if (delay.IsStrictlyNegative()) {
+      m_nLate++;
+      delay = Seconds(0);
+    }
+    Simulator::Schedule(delay, &KiteMobilityReplayer::Apply, this, m_next);
+    m_nPending++;
+    m_hasNext = ReadNext();
+  }
+  m_maxPending = std::max(m_maxPending, m_nPending);
+
+  if (m_hasNext) {
+    // nothing is due before the next line, skip ahead to it
+    m_readEvent = Simulator::Schedule(m_next.time - horizon, &KiteMobilityReplayer::ReadAhead, this);
+  }
+  else {
+    NS_LOG_INFO("End of mobility trace, " << m_nReplayed + m_nPending << " course changes");
+  }
+}
+
+void
+KiteMobilityReplayer::Apply(const CourseChange& change)
+{
+  m_nPending--;
+  m_nReplayed++;
+
+  Ptr<ConstantVelocityMobilityModel> model = m_nodes.Get(change.node)->GetObject<ConstantVelocityMobilityModel>();
+  switch (change.kind) {
+  case CourseChange::STATE:
+    model->SetPosition(change.position);
+    model->SetVelocity(change.velocity);
+    break;
+
+  case CourseChange::COORDINATE: {
+    Vector position = model->GetPosition();
+    double* coordinates[] = {&position.x, &position.y, &position.z};
+    *coordinates[static_cast<int>(change.velocity.x)] = change.velocity.y;
+    model->SetPosition(position);
+    break;
+  }
+
+  case CourseChange::DESTINATION: {
+    m_arrivals[change.node].Cancel();
+    Vector position = model->GetPosition();
+    Vector destination(change.position.x, change.position.y, position.z); // ns-2 moves in the plane
+    double distance = CalculateDistance(position, destination);
+    double speed = change.velocity.x;
+    if (distance == 0 || speed <= 0) {
+      model->SetVelocity(Vector(0, 0, 0));
+      break;
+    }
+    model->SetVelocity(Vector((destination.x - position.x) * speed / distance,
+                              (destination.y - position.y) * speed / distance, 0));
+    m_arrivals[change.node] = Simulator::Schedule(Seconds(distance / speed), &KiteMobilityReplayer::Arrive,
+                                                  this, change.node, destination);
+    break;
+  }
+  }
+}
+
+void
+KiteMobilityReplayer::Arrive(uint32_t node, Vector destination)
+{
+  Ptr<ConstantVelocityMobilityModel> model = m_nodes.Get(node)->GetObject<ConstantVelocityMobilityModel>();
+  model->SetVelocity(Vector(0, 0, 0));
+  model->SetPosition(destination);
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,150 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_MOBILITY_REPLAYER_H
+#define NDN_KITE_MOBILITY_REPLAYER_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/event-id.h"
+#include "ns3/node-container.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Replays a recorded mobility trace onto ConstantVelocityMobilityModel, reading it while the simulation runs
+ *
+ * Two formats are recognized, line by line:
+ *  - the ns-3 ASCII mobility trace of MobilityHelper::EnableAsciiAll,
+ *    "now=+1000000000.0ns node=0 pos=1.0:1.0:0.0 vel=0.5:0.5:0.0";
+ *  - ns-2 movement files, "$node_(0) set X_ 1.0" and "$ns_ at 1.0 "$node_(0) setdest 10.0 20.0 5.0"".
+ *
+ * Only the course changes due within LookAhead are parsed and scheduled, so memory stays bounded
+ * whatever the length of the trace. Lines have to be in time order, as both tools write them;
+ * a line found late is applied when read, and counted.
+ *
+ * Trace node i drives the i-th node of the container; lines of other nodes are skipped.
+ * The trace is only opened once the simulation runs, so that every replica forked before Simulator::Run()
+ * (see KiteReplicator) reads it on its own.
+ */
+class KiteMobilityReplayer : public Object {
+public:
+  static TypeId
+  GetTypeId();
+
+  KiteMobilityReplayer();
+
+  virtual
+  ~KiteMobilityReplayer();
+
+  /**
+   * @brief Gives @p nodes a ConstantVelocityMobilityModel and starts replaying @p filename onto them
+   */
+  void
+  Install(const std::string& filename, const NodeContainer& nodes);
+
+public: // statistics
+  uint64_t
+  GetReplayedCount() const
+  {
+    return m_nReplayed;
+  }
+
+  uint64_t
+  GetLateCount() const
+  {
+    return m_nLate;
+  }
+
+  uint64_t
+  GetSkippedCount() const
+  {
+    return m_nSkipped;
+  }
+
+  /**
+   * @brief Largest number of course changes that were parsed and waiting at once
+   */
+  uint64_t
+  GetMaxPendingCount() const
+  {
+    return m_maxPending;
+  }
+
+protected:
+  virtual void
+  DoDispose();
+
+private:
+  struct CourseChange
+  {
+    enum Kind {
+      STATE,      // ns-3: position and velocity
+      COORDINATE, // ns-2 "set": one coordinate of the position
+      DESTINATION // ns-2 "setdest": head for a point at some speed
+    };
+
+    Time time;
+    uint32_t node;
+    Kind kind;
+    Vector position;
+    Vector velocity; // for COORDINATE, x holds the axis and y the value; for DESTINATION, x holds the speed
+  };
+
+  /**
+   * @brief Opens the trace and schedules its first course changes, when the simulation starts
+   */
+  void
+  Open();
+
+  /**
+   * @brief Parses the next course change of the trace into m_next
+   * @return false at the end of the trace
+   */
+  bool
+  ReadNext();
+
+  /**
+   * @brief Schedules the course changes due before now + LookAhead
+   */
+  void
+  ReadAhead();
+
+  void
+  Apply(const CourseChange& change);
+
+  void
+  Arrive(uint32_t node, Vector destination);
+
+private:
+  Time m_lookAhead;
+
+  std::string m_filename;
+  std::ifstream m_is;
+  NodeContainer m_nodes;
+  std::vector<EventId> m_arrivals; // ns-2 destinations being headed for, by node
+  CourseChange m_next;
+  bool m_hasNext;
+  EventId m_readEvent;
+
+  uint64_t m_nPending;
+  uint64_t m_maxPending;
+  uint64_t m_nReplayed;
+  uint64_t m_nLate;
+  uint64_t m_nSkipped;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_MOBILITY_REPLAYER_H
@@ -0,0 +1,69 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-p2p-face.h"
+#include "ns3/log.h"
+#include "ns3/mac48-address.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/point-to-point-channel.h"
+
+#include "model/ndn-net-device-transport.hpp"
+#include "face/generic-link-service.hpp"
+
+#include <boost/lexical_cast.hpp>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KitePointToPointFace");
+
+namespace ns3 {
+namespace ndn {
+
+static std::string
+constructFaceUri(Ptr<NetDevice> netDevice)
+{
+  std::string uri = "netdev://";
+  Address address = netDevice->GetAddress();
+  if (Mac48Address::IsMatchingType(address)) {
+    uri += "[" + boost::lexical_cast<std::string>(Mac48Address::ConvertFrom(address)) + "]";
+  }
+  return uri;
+}
+
+shared_ptr<Face>
+KitePointToPointFaceCallback(Ptr<Node> node, Ptr<L3Protocol> ndn, Ptr<NetDevice> netDevice)
+{
+  NS_LOG_DEBUG("Creating point-to-point Face on node " << node->GetId());
+
+  Ptr<PointToPointChannel> channel = DynamicCast<PointToPointChannel>(netDevice->GetChannel());
+  NS_ASSERT(channel != nullptr);
+
+  // the other end of the link
+  Ptr<NetDevice> remoteNetDevice = channel->GetDevice(0);
+  if (remoteNetDevice->GetNode() == node) {
+    remoteNetDevice = channel->GetDevice(1);
+  }
+
+  ::nfd::face::GenericLinkService::Options opts;
+  opts.allowFragmentation = true;
+  opts.allowReassembly = true;
+
+  auto linkService = ::ndn::make_unique< ::nfd::face::GenericLinkService>(opts);
+
+  auto transport = ::ndn::make_unique<NetDeviceTransport>(node, netDevice,
+                                                          constructFaceUri(netDevice),
+                                                          constructFaceUri(remoteNetDevice));
+
+  auto face = std::make_shared<Face>(std::move(linkService), std::move(transport));
+  face->setMetric(1);
+
+  ndn->addFace(face);
+  NS_LOG_LOGIC("Node " << node->GetId() << ": added point-to-point Face as face #" << face->getLocalUri());
+
+  return face;
+}
+
+} // namespace ndn
+} // namespace ns3
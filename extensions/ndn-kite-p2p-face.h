@@ -0,0 +1,35 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_P2P_FACE_H
+#define NDN_KITE_P2P_FACE_H
+
+#include "ns3/ndnSIM/model/ndn-common.hpp"
+
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/ndnSIM/model/ndn-l3-protocol.hpp"
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Face creation callback for point-to-point links
+ *
+ * Same as the default point-to-point face of the stack helper, for scenarios that need to
+ * wrap it, such as KiteProfiler::TimeFaces():
+ *
+ *     ndnHelper.UpdateFaceCreateCallback(PointToPointNetDevice::GetTypeId(),
+ *                                        MakeCallback(&ndn::KitePointToPointFaceCallback));
+ */
+shared_ptr<Face>
+KitePointToPointFaceCallback(Ptr<Node> node, Ptr<L3Protocol> ndn, Ptr<NetDevice> netDevice);
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_P2P_FACE_H
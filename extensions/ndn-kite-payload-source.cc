@@ -0,0 +1,162 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-payload-source.h"
+
+#include "ns3/fatal-error.h"
+
+#include <map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3 {
+namespace ndn {
+
+namespace {
+
+class MappedFileSource : public KitePayloadSource {
+public:
+  explicit
+  MappedFileSource(const std::string& path)
+    : m_begin(nullptr)
+    , m_size(0)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      NS_FATAL_ERROR("Cannot open payload file " << path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      NS_FATAL_ERROR("Cannot stat payload file " << path);
+    }
+    m_size = static_cast<uint64_t>(st.st_size);
+
+    if (m_size > 0) {
+      void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        NS_FATAL_ERROR("Cannot map payload file " << path);
+      }
+      m_begin = static_cast<const uint8_t*>(addr);
+      // segments are mostly read in order
+      ::madvise(addr, m_size, MADV_SEQUENTIAL);
+    }
+    ::close(fd); // the mapping keeps the file
+  }
+
+  virtual
+  ~MappedFileSource()
+  {
+    if (m_begin != nullptr) {
+      ::munmap(const_cast<uint8_t*>(m_begin), m_size);
+    }
+  }
+
+  virtual uint64_t
+  GetSize() const
+  {
+    return m_size;
+  }
+
+  virtual const uint8_t*
+  GetSlice(uint64_t offset, size_t length, std::vector<uint8_t>& scratch) const
+  {
+    // reading past the mapping would not fail, it would return whatever lies behind it
+    if (offset > m_size || length > m_size - offset) {
+      NS_FATAL_ERROR("Slice [" << offset << ", " << offset + length << ") past the end of a "
+                     << m_size << "-byte payload file");
+    }
+    return m_begin + offset;
+  }
+
+private:
+  const uint8_t* m_begin;
+  uint64_t m_size;
+};
+
+class GeneratorSource : public KitePayloadSource {
+public:
+  GeneratorSource(uint64_t size, uint64_t seed)
+    : m_size(size)
+    , m_seed(seed)
+  {
+  }
+
+  virtual uint64_t
+  GetSize() const
+  {
+    return m_size;
+  }
+
+  virtual const uint8_t*
+  GetSlice(uint64_t offset, size_t length, std::vector<uint8_t>& scratch) const
+  {
+    scratch.resize(length);
+
+    // every 8-byte word is a splitmix64 output of its index, so any slice can be produced on its own
+    uint64_t word = offset / 8;
+    uint64_t value = Mix(word);
+    for (size_t i = 0; i < length; i++) {
+      uint64_t position = offset + i;
+      if (position / 8 != word) {
+        word = position / 8;
+        value = Mix(word);
+      }
+      scratch[i] = static_cast<uint8_t>(value >> (8 * (position % 8)));
+    }
+    return scratch.data();
+  }
+
+private:
+  uint64_t
+  Mix(uint64_t index) const
+  {
+    uint64_t z = m_seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+private:
+  uint64_t m_size;
+  uint64_t m_seed;
+};
+
+} // anonymous namespace
+
+shared_ptr<KitePayloadSource>
+KitePayloadSource::CreateFromFile(const std::string& path)
+{
+  // thousands of mobiles may upload the same file
+  static std::map<std::string, weak_ptr<KitePayloadSource>> mappings;
+
+  auto it = mappings.find(path);
+  if (it != mappings.end()) {
+    shared_ptr<KitePayloadSource> source = it->second.lock();
+    if (source != nullptr) {
+      return source;
+    }
+  }
+
+  auto source = make_shared<MappedFileSource>(path);
+  mappings[path] = source;
+  return source;
+}
+
+shared_ptr<KitePayloadSource>
+KitePayloadSource::CreateGenerator(uint64_t size, uint64_t seed)
+{
+  return make_shared<GeneratorSource>(size, seed);
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,62 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_PAYLOAD_SOURCE_H
+#define NDN_KITE_PAYLOAD_SOURCE_H
+
+#include "ns3/ndnSIM/model/ndn-common.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Bytes of an upload object, read slice by slice so the object never has to be held in memory
+ */
+class KitePayloadSource : boost::noncopyable {
+public:
+  virtual
+  ~KitePayloadSource()
+  {
+  }
+
+  virtual uint64_t
+  GetSize() const = 0;
+
+  /**
+   * @brief Returns @p length bytes of the object starting at @p offset
+   *
+   * The pointer stays valid as long as the source and @p scratch do. Sources that have the bytes
+   * in memory return a pointer into them, others generate them into @p scratch.
+   * The caller makes sure offset + length <= GetSize(); a file source stops the simulation otherwise.
+   * Reading a slice copies nothing, but a Data packet built from it does: ndn-cxx Blocks own their
+   * buffers, so the slice is copied once into the content of the segment.
+   */
+  virtual const uint8_t*
+  GetSlice(uint64_t offset, size_t length, std::vector<uint8_t>& scratch) const = 0;
+
+  /**
+   * @brief Maps a file read-only; all sources of the same file share one mapping
+   */
+  static shared_ptr<KitePayloadSource>
+  CreateFromFile(const std::string& path);
+
+  /**
+   * @brief Pseudo-random bytes computed from @p seed and the offset, nothing is stored
+   */
+  static shared_ptr<KitePayloadSource>
+  CreateGenerator(uint64_t size, uint64_t seed);
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_PAYLOAD_SOURCE_H
@@ -0,0 +1,184 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-priority-queue.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/ppp-header.h"
+
+#include "ns3/ndnSIM/model/ndn-common.hpp"
+
+#include <ndn-cxx/interest.hpp>
+#include <ndn-cxx/lp/tlv.hpp>
+#include <ndn-cxx/encoding/tlv.hpp>
+
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KitePriorityQueue");
+
+namespace ns3 {
+namespace ndn {
+
+NS_OBJECT_ENSURE_REGISTERED(KitePriorityQueue);
+
+TypeId
+KitePriorityQueue::GetTypeId(void)
+{
+  static TypeId tid =
+    TypeId("ns3::ndn::KitePriorityQueue")
+      .SetGroupName("Ndn")
+      .SetParent<Queue>()
+      .AddConstructor<KitePriorityQueue>()
+
+      .AddAttribute("MaxPacketsPerBand", "The maximum number of packets accepted by each band",
+                    UintegerValue(10),
+                    MakeUintegerAccessor(&KitePriorityQueue::m_maxPacketsPerBand),
+                    MakeUintegerChecker<uint32_t>())
+
+    ;
+
+  return tid;
+}
+
+KitePriorityQueue::KitePriorityQueue()
+  : m_maxPacketsPerBand(10)
+{
+  NS_LOG_FUNCTION_NOARGS();
+
+  for (int band = 0; band < BAND_MAX; ++band) {
+    m_drops[band] = 0;
+    m_enqueues[band] = 0;
+  }
+}
+
+KitePriorityQueue::~KitePriorityQueue()
+{
+  NS_LOG_FUNCTION_NOARGS();
+}
+
+KitePriorityQueue::Band
+KitePriorityQueue::Classify(Ptr<const Packet> packet)
+{
+  // only the PPP header, the LpPacket header fields and the outer type of the fragment are read,
+  // Data and Nacks are classified from these without copying or decoding the rest
+  uint8_t buffer[PEEK_SIZE];
+  const uint8_t* end = buffer + packet->CopyData(buffer, sizeof(buffer));
+  const uint8_t* begin = buffer + PppHeader().GetSerializedSize();
+  if (begin >= end) {
+    return BAND_DATA;
+  }
+
+  uint64_t type = 0;
+  uint64_t length = 0;
+  const uint8_t* network = begin;
+  if (!::ndn::tlv::readVarNumber(begin, end, type) || !::ndn::tlv::readVarNumber(begin, end, length)) {
+    return BAND_DATA;
+  }
+
+  if (type == ::ndn::lp::tlv::LpPacket) {
+    while (true) {
+      if (!::ndn::tlv::readVarNumber(begin, end, type) || !::ndn::tlv::readVarNumber(begin, end, length)) {
+        return BAND_DATA; // e.g., idle packet, or header fields past the peeked bytes
+      }
+      if (type == ::ndn::lp::tlv::Fragment) {
+        break;
+      }
+      if (type == ::ndn::lp::tlv::Nack || length > static_cast<uint64_t>(end - begin)) {
+        return BAND_DATA;
+      }
+      if (type == ::ndn::lp::tlv::FragIndex &&
+          std::any_of(begin, begin + length, [] (uint8_t byte) { return byte != 0; })) {
+        return BAND_DATA; // only the first fragment carries the network header
+      }
+      begin += length;
+    }
+    network = begin;
+    if (!::ndn::tlv::readVarNumber(begin, end, type) || !::ndn::tlv::readVarNumber(begin, end, length)) {
+      return BAND_DATA;
+    }
+  }
+
+  if (type != ::ndn::tlv::Interest) {
+    return BAND_DATA;
+  }
+
+  // Interests are small, decode this one for its trace flag
+  uint32_t offset = network - buffer;
+  if (begin - buffer + length > packet->GetSize()) {
+    return BAND_DATA; // fragmented Interest
+  }
+  uint32_t size = (begin - network) + length;
+  std::vector<uint8_t> wire(size);
+  packet->CreateFragment(offset, size)->CopyData(wire.data(), size);
+
+  try {
+    Interest interest(Block(wire.data(), wire.size()));
+    uint8_t traceFlag = interest.getTraceFlag();
+    if (traceFlag == 1 || traceFlag == 2) {
+      return BAND_CONTROL;
+    }
+    return BAND_INTEREST;
+  }
+  catch (const ::ndn::tlv::Error&) {
+    return BAND_DATA;
+  }
+}
+
+bool
+KitePriorityQueue::DoEnqueue(Ptr<QueueItem> item)
+{
+  NS_LOG_FUNCTION(this << item);
+
+  Band band = Classify(item->GetPacket());
+  if (m_bands[band].size() >= m_maxPacketsPerBand) {
+    ++m_drops[band];
+    NS_LOG_LOGIC("Band " << band << " full, dropping, drops in band: " << m_drops[band]);
+    Drop(item);
+    return false;
+  }
+
+  m_bands[band].push(item);
+  ++m_enqueues[band];
+  return true;
+}
+
+Ptr<QueueItem>
+KitePriorityQueue::DoDequeue(void)
+{
+  NS_LOG_FUNCTION(this);
+
+  for (int band = 0; band < BAND_MAX; ++band) {
+    if (!m_bands[band].empty()) {
+      Ptr<QueueItem> item = m_bands[band].front();
+      m_bands[band].pop();
+      return item;
+    }
+  }
+  return 0;
+}
+
+Ptr<QueueItem>
+KitePriorityQueue::DoRemove(void)
+{
+  return DoDequeue();
+}
+
+Ptr<const QueueItem>
+KitePriorityQueue::DoPeek(void) const
+{
+  NS_LOG_FUNCTION(this);
+
+  for (int band = 0; band < BAND_MAX; ++band) {
+    if (!m_bands[band].empty()) {
+      return m_bands[band].front();
+    }
+  }
+  return 0;
+}
+
+} // namespace ndn
+} // namespace ns3
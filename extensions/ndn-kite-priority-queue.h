@@ -0,0 +1,104 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_PRIORITY_QUEUE_H
+#define NDN_KITE_PRIORITY_QUEUE_H
+
+#include "ns3/queue.h"
+
+#include <queue>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Multi-band device queue that serves Kite control traffic first
+ *
+ * Packets on a point-to-point device are classified by the Interest's trace flag:
+ *   - band 0: traces (flag 1) and tracing Interests (flag 2)
+ *   - band 1: other Interests
+ *   - band 2: Data, Nacks and anything that cannot be parsed
+ *
+ * A lower band is always dequeued first. Each band has its own limit and drop counter,
+ * so bulk Data filling its band does not push control Interests out.
+ *
+ * Usage:
+ *
+ *     p2p.SetQueue("ns3::ndn::KitePriorityQueue", "MaxPacketsPerBand", UintegerValue(10),
+ *                  "MaxPackets", UintegerValue(30));
+ *
+ * The base class MaxPackets limit applies to all bands together and should be at least
+ * BAND_MAX times MaxPacketsPerBand.
+ */
+class KitePriorityQueue : public Queue {
+public:
+  static TypeId
+  GetTypeId(void);
+
+  enum Band {
+    BAND_CONTROL = 0,
+    BAND_INTEREST,
+    BAND_DATA,
+    BAND_MAX
+  };
+
+  KitePriorityQueue();
+
+  virtual ~KitePriorityQueue();
+
+  /**
+   * @brief Returns the band a packet from the device belongs to
+   *
+   * Reads the outer TLV types from the first PEEK_SIZE bytes of the frame and only decodes Interests.
+   */
+  static Band
+  Classify(Ptr<const Packet> packet);
+
+  static const uint32_t PEEK_SIZE = 128;
+
+  /**
+   * @brief Number of packets dropped from a band because it was full
+   */
+  uint64_t
+  GetDropCount(Band band) const
+  {
+    return m_drops[band];
+  }
+
+  /**
+   * @brief Number of packets enqueued in a band
+   */
+  uint64_t
+  GetEnqueueCount(Band band) const
+  {
+    return m_enqueues[band];
+  }
+
+private:
+  virtual bool
+  DoEnqueue(Ptr<QueueItem> item);
+
+  virtual Ptr<QueueItem>
+  DoDequeue(void);
+
+  virtual Ptr<QueueItem>
+  DoRemove(void);
+
+  virtual Ptr<const QueueItem>
+  DoPeek(void) const;
+
+private:
+  uint32_t m_maxPacketsPerBand;
+  std::queue<Ptr<QueueItem>> m_bands[BAND_MAX];
+  uint64_t m_drops[BAND_MAX];
+  uint64_t m_enqueues[BAND_MAX];
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_PRIORITY_QUEUE_H
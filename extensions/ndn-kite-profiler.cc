@@ -0,0 +1,403 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-profiler.h"
+#include "ndn-kite-metrics.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/pointer.h"
+#include "ns3/object-factory.h"
+#include "ns3/event-impl.h"
+#include "ns3/node.h"
+
+#include "ns3/ndnSIM/model/ndn-l3-protocol.hpp"
+
+#include "trace-forwarding.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <typeinfo>
+
+#include <cxxabi.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteProfiler");
+
+namespace ns3 {
+namespace ndn {
+
+namespace {
+
+std::string
+demangle(const char* name)
+{
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0) {
+    return name;
+  }
+  std::string result = demangled;
+  std::free(demangled);
+  return result;
+}
+
+// the first component whose pattern appears in the demangled event type, applications before ndn
+// since they live in ns3::ndn too
+const std::pair<const char*, const char*> COMPONENTS[] = {
+  {"KiteProfiler", "profiler"},
+  {"ns3::ndn::KiteUpload", "applications"},
+  {"ns3::ndn::App", "applications"},
+  {"ns3::ndn::Consumer", "applications"},
+  {"ns3::ndn::Producer", "applications"},
+  {"ns3::Application", "applications"},
+  {"MobilityModel", "mobility"},
+  {"KiteMobilityReplayer", "mobility"},
+  {"KiteRange", "range channel"},
+  {"Wifi", "wifi"},
+  {"Yans", "wifi"},
+  {"MacLow", "wifi"},
+  {"DcfManager", "wifi"},
+  {"PointToPoint", "point-to-point"},
+  {"KiteContactTimeline", "point-to-point"},
+  {"nfd::", "ndn"},
+  {"ndn::", "ndn"},
+};
+
+std::string
+getComponent(const std::string& type)
+{
+  for (const auto& component : COMPONENTS) {
+    if (type.find(component.first) != std::string::npos) {
+      return component.second;
+    }
+  }
+  return "other";
+}
+
+// resident set size now, in KiB, 0 where /proc is not available
+uint64_t
+getRss()
+{
+  std::ifstream is("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  if (!(is >> size >> resident)) {
+    return 0;
+  }
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+} // anonymous namespace
+
+NS_OBJECT_ENSURE_REGISTERED(KiteProfiler);
+
+TypeId
+KiteProfiler::GetTypeId()
+{
+  static TypeId tid =
+    TypeId("ns3::ndn::KiteProfiler")
+      .SetGroupName("Ndn")
+      .SetParent<Object>()
+      .AddConstructor<KiteProfiler>()
+
+      .AddAttribute("SampleInterval", "Simulated time between two samples of the queue size and memory",
+                    StringValue("1s"), MakeTimeAccessor(&KiteProfiler::m_sampleInterval), MakeTimeChecker());
+
+  return tid;
+}
+
+KiteProfiler::KiteProfiler()
+  : m_current(nullptr)
+  , m_isReceiving(false)
+  , m_nestedSeconds(0)
+  , m_forwarding{0, 0}
+  , m_nEvents(0)
+  , m_queueSize(0)
+  , m_maxQueueSize(0)
+{
+}
+
+void
+KiteProfiler::Start()
+{
+  ObjectFactory factory;
+  factory.SetTypeId(KiteProfilingScheduler::GetTypeId());
+  factory.Set("Profiler", PointerValue(Ptr<KiteProfiler>(this)));
+  Simulator::SetScheduler(factory);
+
+  m_start = std::chrono::steady_clock::now();
+  m_lastEvent = m_start;
+  Sample();
+}
+
+StackHelper::FaceCreateCallback
+KiteProfiler::TimeFaces(const StackHelper::FaceCreateCallback& create)
+{
+  return MakeBoundCallback(&KiteProfiler::CreateTimedFace, Ptr<KiteProfiler>(this), create);
+}
+
+shared_ptr<Face>
+KiteProfiler::CreateTimedFace(Ptr<KiteProfiler> profiler, StackHelper::FaceCreateCallback create,
+                              Ptr<Node> node, Ptr<L3Protocol> ndn, Ptr<NetDevice> netDevice)
+{
+  // the transport listens promiscuously. Devices deliver promiscuous and plain handlers in separate
+  // passes, in an order of their own (wifi runs the plain pass first), but within a pass the node calls
+  // the handlers in the order they were registered. So both probes listen promiscuously too and
+  // enclose the transport's handler in the same pass
+  node->RegisterProtocolHandler(MakeCallback(&KiteProfiler::OnReceiveStart, PeekPointer(profiler)),
+                                L3Protocol::ETHERNET_FRAME_TYPE, netDevice, true);
+  shared_ptr<Face> face = create(node, ndn, netDevice);
+  node->RegisterProtocolHandler(MakeCallback(&KiteProfiler::OnReceiveEnd, PeekPointer(profiler)),
+                                L3Protocol::ETHERNET_FRAME_TYPE, netDevice, true);
+  return face;
+}
+
+void
+KiteProfiler::OnReceiveStart(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                             const Address& from, const Address& to, NetDevice::PacketType packetType)
+{
+  m_receiveStart = std::chrono::steady_clock::now();
+  m_isReceiving = true;
+}
+
+void
+KiteProfiler::OnReceiveEnd(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                           const Address& from, const Address& to, NetDevice::PacketType packetType)
+{
+  if (!m_isReceiving) {
+    return;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_receiveStart).count();
+  m_isReceiving = false;
+  m_nestedSeconds += seconds;
+  m_forwarding.count++;
+  m_forwarding.seconds += seconds;
+}
+
+void
+KiteProfiler::OnEvent(const EventImpl* event)
+{
+  CloseEvent();
+  m_current = &m_eventTypes[std::type_index(typeid(*event))];
+  m_current->count++;
+  m_nEvents++;
+}
+
+void
+KiteProfiler::CloseEvent()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (m_current != nullptr) {
+    m_current->seconds += std::chrono::duration<double>(now - m_lastEvent).count() - m_nestedSeconds;
+  }
+  m_lastEvent = now;
+  m_nestedSeconds = 0;
+  m_isReceiving = false;
+}
+
+void
+KiteProfiler::OnInsert()
+{
+  m_queueSize++;
+  m_maxQueueSize = std::max(m_maxQueueSize, m_queueSize);
+}
+
+void
+KiteProfiler::OnRemove()
+{
+  m_queueSize--;
+}
+
+double
+KiteProfiler::GetEventRate() const
+{
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  return seconds > 0 ? m_nEvents / seconds : 0;
+}
+
+uint64_t
+KiteProfiler::GetPeakRss()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_maxrss; // KiB on Linux
+}
+
+void
+KiteProfiler::Sample()
+{
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  m_samples.push_back({Simulator::Now().GetSeconds(), wall, m_nEvents, m_queueSize, getRss()});
+  Simulator::Schedule(m_sampleInterval, &KiteProfiler::Sample, this);
+}
+
+void
+KiteProfiler::AddTo(KiteMetrics& metrics, const NodeContainer& nodes)
+{
+  CloseEvent();
+  m_current = nullptr;
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  metrics.Set("events", m_nEvents);
+  metrics.Set("wallSeconds", wall);
+  metrics.Set("eventsPerSecond", GetEventRate());
+  metrics.Set("simulatedSeconds", Simulator::Now().GetSeconds());
+  metrics.Set("maxQueueSize", m_maxQueueSize);
+  metrics.Set("peakRssKiB", GetPeakRss());
+
+  std::ostringstream os;
+  os << "[";
+  for (size_t i = 0; i < m_samples.size(); ++i) {
+    const Snapshot& sample = m_samples[i];
+    os << (i == 0 ? "\n    " : ",\n    ") << "{\"time\": " << sample.time << ", \"wall\": " << sample.wall
+       << ", \"events\": " << sample.events << ", \"queueSize\": " << sample.queueSize
+       << ", \"rssKiB\": " << sample.rss << "}";
+  }
+  os << "\n  ]";
+  metrics.SetJson("samples", os.str());
+
+  // slowest first, by type then by component
+  std::vector<std::pair<std::string, EventType>> types;
+  std::map<std::string, EventType> components;
+  for (const auto& type : m_eventTypes) {
+    types.emplace_back(demangle(type.first.name()), type.second);
+    EventType& component = components[getComponent(types.back().first)];
+    component.count += type.second.count;
+    component.seconds += type.second.seconds;
+  }
+  if (m_forwarding.count > 0) {
+    components["nfd forwarding"] = m_forwarding;
+  }
+  std::sort(types.begin(), types.end(),
+            [] (const std::pair<std::string, EventType>& a, const std::pair<std::string, EventType>& b) {
+              return a.second.seconds > b.second.seconds;
+            });
+
+  os.str("");
+  os << "{";
+  for (auto component = components.begin(); component != components.end(); ++component) {
+    os << (component == components.begin() ? "\n    " : ",\n    ") << KiteMetrics::Quote(component->first)
+       << ": {\"events\": " << component->second.count << ", \"seconds\": " << component->second.seconds << "}";
+  }
+  os << "\n  }";
+  metrics.SetJson("components", os.str());
+
+  os.str("");
+  os << "[";
+  for (size_t i = 0; i < types.size(); ++i) {
+    os << (i == 0 ? "\n    " : ",\n    ") << "{\"type\": " << KiteMetrics::Quote(types[i].first)
+       << ", \"component\": " << KiteMetrics::Quote(getComponent(types[i].first))
+       << ", \"events\": " << types[i].second.count << ", \"seconds\": " << types[i].second.seconds << "}";
+  }
+  os << "\n  ]";
+  metrics.SetJson("eventTypes", os.str());
+
+  metrics.SetJson("nodes", GetNodeTables(nodes));
+}
+
+std::string
+KiteProfiler::GetNodeTables(const NodeContainer& nodes) const
+{
+  // bytes are the wire sizes of the packets the entries keep, not the memory of the entries themselves
+  std::ostringstream os;
+  os << "[";
+  bool isFirst = true;
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr<L3Protocol> l3 = nodes.Get(i)->GetObject<L3Protocol>();
+    if (l3 == nullptr) {
+      continue;
+    }
+    ::nfd::Forwarder& forwarder = *l3->getForwarder();
+
+    uint64_t pitBytes = 0;
+    for (const ::nfd::pit::Entry& entry : forwarder.getPit()) {
+      pitBytes += entry.getInterest().wireEncode().size();
+    }
+    uint64_t csBytes = 0;
+    for (const ::nfd::cs::Entry& entry : forwarder.getCs()) {
+      csBytes += entry.getData().wireEncode().size();
+    }
+
+    os << (isFirst ? "\n    " : ",\n    ") << "{\"node\": " << nodes.Get(i)->GetId()
+       << ", \"pit\": " << forwarder.getPit().size() << ", \"pitBytes\": " << pitBytes
+       << ", \"cs\": " << forwarder.getCs().size() << ", \"csBytes\": " << csBytes;
+
+    auto strategy = dynamic_cast<::nfd::fw::TraceForwardingStrategy*>(
+      &forwarder.getStrategyChoice().findEffectiveStrategy("/"));
+    if (strategy != nullptr) {
+      uint64_t ttBytes = 0;
+      for (const auto& entry : strategy->getTt()) {
+        ttBytes += entry.second->getInterest().wireEncode().size();
+      }
+      uint64_t ittBytes = 0;
+      for (const auto& entry : strategy->getItt()) {
+        ittBytes += entry->getInterest().wireEncode().size();
+      }
+      os << ", \"tt\": " << strategy->getTt().size() << ", \"ttBytes\": " << ttBytes
+         << ", \"itt\": " << strategy->getItt().size() << ", \"ittBytes\": " << ittBytes;
+    }
+    os << "}";
+    isFirst = false;
+  }
+  os << "\n  ]";
+  return os.str();
+}
+
+NS_OBJECT_ENSURE_REGISTERED(KiteProfilingScheduler);
+
+TypeId
+KiteProfilingScheduler::GetTypeId()
+{
+  static TypeId tid =
+    TypeId("ns3::ndn::KiteProfilingScheduler")
+      .SetGroupName("Ndn")
+      .SetParent<MapScheduler>()
+      .AddConstructor<KiteProfilingScheduler>()
+
+      .AddAttribute("Profiler", "The profiler to report events to", PointerValue(),
+                    MakePointerAccessor(&KiteProfilingScheduler::m_profiler), MakePointerChecker<KiteProfiler>());
+
+  return tid;
+}
+
+KiteProfilingScheduler::KiteProfilingScheduler()
+{
+}
+
+void
+KiteProfilingScheduler::Insert(const Event& ev)
+{
+  MapScheduler::Insert(ev);
+  m_profiler->OnInsert();
+}
+
+Scheduler::Event
+KiteProfilingScheduler::RemoveNext()
+{
+  Event ev = MapScheduler::RemoveNext();
+  m_profiler->OnRemove();
+  m_profiler->OnEvent(ev.impl);
+  return ev;
+}
+
+void
+KiteProfilingScheduler::Remove(const Event& ev)
+{
+  MapScheduler::Remove(ev);
+  m_profiler->OnRemove();
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,221 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_PROFILER_H
+#define NDN_KITE_PROFILER_H
+
+#include "ns3/object.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+
+#include "ns3/ndnSIM/helper/ndn-stack-helper.hpp"
+
+#include <chrono>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+class KiteMetrics;
+
+/**
+ * @brief Where the wall time and memory of a run go, without an external profiler
+ *
+ * Start() swaps the simulator's scheduler for one that reports every event to the profiler.
+ * The wall time of an event runs from the moment it leaves the queue to the moment the next one does, so
+ * it includes whatever the event calls synchronously. Event types are the demangled types of the
+ * scheduled calls, grouped into components (wifi, ndn, applications, ...) by name.
+ *
+ * NFD processing a received packet runs inside the device event that delivers it. Faces created
+ * through TimeFaces() time it on their own: that time is taken out of the device event and reported
+ * as the "nfd forwarding" component, one event per packet. It includes the local applications the
+ * packet reaches synchronously.
+ *
+ * Every SampleInterval of simulated time, the profiler also records the queue size, the events so far
+ * and the resident memory. At the end, AddTo() adds the totals, the samples, the per-type times and the
+ * PIT, CS, Tt and Itt of every node to a KiteMetrics:
+ *
+ *     Ptr<ndn::KiteProfiler> profiler = CreateObject<ndn::KiteProfiler>();
+ *     ndnHelper.UpdateFaceCreateCallback(PointToPointNetDevice::GetTypeId(),
+ *                                        profiler->TimeFaces(MakeCallback(&ndn::KitePointToPointFaceCallback)));
+ *     ndnHelper.InstallAll();
+ *     ...
+ *     profiler->Start();
+ *     Simulator::Run();
+ *     ndn::KiteMetrics profile;
+ *     profiler->AddTo(profile, NodeContainer::GetGlobal());
+ *     profile.Save("profile.json");
+ */
+class KiteProfiler : public Object {
+public:
+  static TypeId
+  GetTypeId();
+
+  KiteProfiler();
+
+  /**
+   * @brief Installs the profiling scheduler and starts sampling, right before Simulator::Run()
+   *
+   * Sampling never runs out of events, so the run needs a Simulator::Stop().
+   */
+  void
+  Start();
+
+  /**
+   * @brief Wraps a face creation callback so that the faces it creates time NFD apart from their devices
+   *
+   * Installs the profiler's handlers on the device around the face's transport, so it has to be used
+   * before the stack is installed. The transport must receive promiscuously, as NetDeviceTransport does.
+   */
+  StackHelper::FaceCreateCallback
+  TimeFaces(const StackHelper::FaceCreateCallback& create);
+
+  /**
+   * @brief Called by the scheduler whenever the simulator takes the next event
+   */
+  void
+  OnEvent(const EventImpl* event);
+
+  void
+  OnInsert();
+
+  void
+  OnRemove();
+
+  uint64_t
+  GetEventCount() const
+  {
+    return m_nEvents;
+  }
+
+  /**
+   * @brief Packets NFD received through faces of TimeFaces()
+   */
+  uint64_t
+  GetForwardedCount() const
+  {
+    return m_forwarding.count;
+  }
+
+  /**
+   * @brief Events per wall second since Start()
+   */
+  double
+  GetEventRate() const;
+
+  /**
+   * @brief Largest resident set size of the process so far, in KiB
+   */
+  static uint64_t
+  GetPeakRss();
+
+  /**
+   * @brief Adds the profile of the run so far, with the tables of @p nodes
+   */
+  void
+  AddTo(KiteMetrics& metrics, const NodeContainer& nodes);
+
+private:
+  static shared_ptr<Face>
+  CreateTimedFace(Ptr<KiteProfiler> profiler, StackHelper::FaceCreateCallback create,
+                  Ptr<Node> node, Ptr<L3Protocol> ndn, Ptr<NetDevice> netDevice);
+
+  /**
+   * @brief Called by the device before NFD receives a packet
+   */
+  void
+  OnReceiveStart(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                 const Address& from, const Address& to, NetDevice::PacketType packetType);
+
+  /**
+   * @brief Called by the device once NFD is done with the packet
+   */
+  void
+  OnReceiveEnd(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+               const Address& from, const Address& to, NetDevice::PacketType packetType);
+
+  void
+  Sample();
+
+  /**
+   * @brief Charges the time since the last event to it, less the time spent in NFD
+   */
+  void
+  CloseEvent();
+
+  std::string
+  GetNodeTables(const NodeContainer& nodes) const;
+
+private:
+  struct EventType
+  {
+    uint64_t count;
+    double seconds;
+  };
+
+  struct Snapshot
+  {
+    double time;    // simulated seconds
+    double wall;    // wall seconds since Start()
+    uint64_t events;
+    uint64_t queueSize;
+    uint64_t rss;   // KiB
+  };
+
+  Time m_sampleInterval;
+
+  std::chrono::steady_clock::time_point m_start;
+  std::chrono::steady_clock::time_point m_lastEvent;
+  std::unordered_map<std::type_index, EventType> m_eventTypes;
+  EventType* m_current; // type of the event running now
+
+  std::chrono::steady_clock::time_point m_receiveStart;
+  bool m_isReceiving;     // between OnReceiveStart() and OnReceiveEnd() of the same packet
+  double m_nestedSeconds; // spent in NFD during the current event
+  EventType m_forwarding;
+
+  uint64_t m_nEvents;
+  uint64_t m_queueSize;
+  uint64_t m_maxQueueSize;
+  std::vector<Snapshot> m_samples;
+};
+
+/**
+ * @brief Map scheduler reporting every event it hands out to a KiteProfiler
+ */
+class KiteProfilingScheduler : public MapScheduler {
+public:
+  static TypeId
+  GetTypeId();
+
+  KiteProfilingScheduler();
+
+  // inherited from Scheduler
+  virtual void
+  Insert(const Event& ev);
+
+  virtual Event
+  RemoveNext();
+
+  virtual void
+  Remove(const Event& ev);
+
+private:
+  Ptr<KiteProfiler> m_profiler;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_PROFILER_H
@@ -0,0 +1,503 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-range-channel.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/mobility-model.h"
+#include "ns3/boolean.h"
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteRangeChannel");
+
+namespace ns3 {
+namespace ndn {
+
+NS_OBJECT_ENSURE_REGISTERED(KiteRangeChannel);
+NS_OBJECT_ENSURE_REGISTERED(KiteRangeNetDevice);
+
+TypeId
+KiteRangeChannel::GetTypeId()
+{
+  static TypeId tid =
+    TypeId("ns3::ndn::KiteRangeChannel")
+      .SetGroupName("Ndn")
+      .SetParent<Channel>()
+      .AddConstructor<KiteRangeChannel>()
+
+      .AddAttribute("Range", "Distance in meters within which frames are always received", DoubleValue(50),
+                    MakeDoubleAccessor(&KiteRangeChannel::m_range), MakeDoubleChecker<double>(0))
+      .AddAttribute("FadeRange", "Distance beyond Range over which the reception probability falls to 0",
+                    DoubleValue(0),
+                    MakeDoubleAccessor(&KiteRangeChannel::m_fadeRange), MakeDoubleChecker<double>(0))
+      .AddAttribute("LossRate", "Probability that a frame is lost regardless of distance", DoubleValue(0),
+                    MakeDoubleAccessor(&KiteRangeChannel::m_lossRate), MakeDoubleChecker<double>(0, 1))
+      .AddAttribute("Delay", "Propagation delay", StringValue("1us"),
+                    MakeTimeAccessor(&KiteRangeChannel::m_delay), MakeTimeChecker())
+      .AddAttribute("SpatialIndex", "Only check the receivers in the cells around the sender", BooleanValue(true),
+                    MakeBooleanAccessor(&KiteRangeChannel::m_useSpatialIndex), MakeBooleanChecker());
+
+  return tid;
+}
+
+KiteRangeChannel::KiteRangeChannel()
+  : m_useSpatialIndex(true)
+  , m_random(CreateObject<UniformRandomVariable>())
+  , m_nFrames(0)
+  , m_nCandidates(0)
+{
+}
+
+void
+KiteRangeChannel::Add(Ptr<KiteRangeNetDevice> device)
+{
+  Ptr<MobilityModel> mobility = device->GetNode()->GetObject<MobilityModel>();
+  NS_ABORT_MSG_IF(mobility == nullptr, "Nodes need a mobility model before joining a KiteRangeChannel");
+
+  uint32_t index = m_devices.size();
+  m_devices.push_back(device);
+  m_mobilities.push_back(mobility);
+  m_deviceCells.push_back(GetCell(mobility->GetPosition()));
+  m_rebinEvents.emplace_back();
+  m_cells[m_deviceCells[index]].push_back(index);
+
+  std::vector<uint32_t>& nodeDevices = m_nodeDevices[device->GetNode()->GetId()];
+  if (nodeDevices.empty()) {
+    mobility->TraceConnectWithoutContext("CourseChange", MakeCallback(&KiteRangeChannel::OnCourseChange, this));
+  }
+  nodeDevices.push_back(index);
+  Rebin(index);
+}
+
+uint64_t
+KiteRangeChannel::GetCell(const Vector& position) const
+{
+  double side = m_range + m_fadeRange;
+  if (!m_useSpatialIndex || side <= 0) {
+    return 0; // one cell for all
+  }
+  int32_t x = static_cast<int32_t>(std::floor(position.x / side));
+  int32_t y = static_cast<int32_t>(std::floor(position.y / side));
+  return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+void
+KiteRangeChannel::OnCourseChange(Ptr<const MobilityModel> model)
+{
+  auto it = m_nodeDevices.find(model->GetObject<Node>()->GetId());
+  if (it == m_nodeDevices.end()) {
+    return;
+  }
+  for (uint32_t index : it->second) {
+    Rebin(index);
+  }
+}
+
+void
+KiteRangeChannel::Rebin(uint32_t index)
+{
+  m_rebinEvents[index].Cancel();
+
+  Vector position = m_mobilities[index]->GetPosition();
+  uint64_t cell = GetCell(position);
+  if (cell != m_deviceCells[index]) {
+    std::vector<uint32_t>& oldCell = m_cells[m_deviceCells[index]];
+    oldCell.erase(std::find(oldCell.begin(), oldCell.end(), index));
+    if (oldCell.empty()) {
+      m_cells.erase(m_deviceCells[index]);
+    }
+    m_cells[cell].push_back(index);
+    m_deviceCells[index] = cell;
+  }
+
+  double side = m_range + m_fadeRange;
+  Vector velocity = m_mobilities[index]->GetVelocity();
+  if (!m_useSpatialIndex || side <= 0 || (velocity.x == 0 && velocity.y == 0)) {
+    return;
+  }
+
+  // time to the first cell border on the current course
+  double exitTime = std::numeric_limits<double>::max();
+  double xMin = std::floor(position.x / side) * side;
+  double yMin = std::floor(position.y / side) * side;
+  if (velocity.x > 0) {
+    exitTime = std::min(exitTime, (xMin + side - position.x) / velocity.x);
+  }
+  else if (velocity.x < 0) {
+    exitTime = std::min(exitTime, (xMin - position.x) / velocity.x);
+  }
+  if (velocity.y > 0) {
+    exitTime = std::min(exitTime, (yMin + side - position.y) / velocity.y);
+  }
+  else if (velocity.y < 0) {
+    exitTime = std::min(exitTime, (yMin - position.y) / velocity.y);
+  }
+  // a nanosecond past the border, so the position is in the next cell
+  m_rebinEvents[index] = Simulator::Schedule(Seconds(exitTime) + NanoSeconds(1), &KiteRangeChannel::Rebin,
+                                             this, index);
+}
+
+uint32_t
+KiteRangeChannel::GetNDevices() const
+{
+  return m_devices.size();
+}
+
+Ptr<NetDevice>
+KiteRangeChannel::GetDevice(uint32_t i) const
+{
+  return m_devices[i];
+}
+
+int64_t
+KiteRangeChannel::AssignStreams(int64_t stream)
+{
+  m_random->SetStream(stream);
+  return 1;
+}
+
+bool
+KiteRangeChannel::IsReceived(double distance) const
+{
+  if (distance > m_range + m_fadeRange) {
+    return false;
+  }
+  if (distance > m_range && m_random->GetValue() >= (m_range + m_fadeRange - distance) / m_fadeRange) {
+    return false;
+  }
+  return m_lossRate == 0 || m_random->GetValue() >= m_lossRate;
+}
+
+void
+KiteRangeChannel::Send(Ptr<const Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from,
+                       Ptr<KiteRangeNetDevice> sender, Time txTime)
+{
+  Ptr<MobilityModel> senderMobility = sender->GetNode()->GetObject<MobilityModel>();
+  NS_ASSERT_MSG(senderMobility != nullptr, "Nodes on a KiteRangeChannel need a mobility model");
+
+  m_nFrames++;
+
+  auto deliver = [&] (uint32_t index) {
+    const Ptr<KiteRangeNetDevice>& device = m_devices[index];
+    if (device == sender) {
+      return;
+    }
+    m_nCandidates++;
+    if (!IsReceived(senderMobility->GetDistanceFrom(m_mobilities[index]))) {
+      return;
+    }
+    Simulator::ScheduleWithContext(device->GetNode()->GetId(), txTime + m_delay, &KiteRangeNetDevice::Receive,
+                                   device, packet->Copy(), protocol, to, from);
+  };
+
+  if (!m_useSpatialIndex || m_range + m_fadeRange <= 0) {
+    for (uint32_t index = 0; index < m_devices.size(); ++index) {
+      deliver(index);
+    }
+    return;
+  }
+
+  uint64_t cell = GetCell(senderMobility->GetPosition());
+  // cells are as wide as the reach of a frame, so receivers are in the 3 x 3 cells around the sender
+  int32_t x = static_cast<int32_t>(cell >> 32);
+  int32_t y = static_cast<int32_t>(cell & 0xffffffff);
+  for (int32_t dx = -1; dx <= 1; ++dx) {
+    for (int32_t dy = -1; dy <= 1; ++dy) {
+      uint64_t neighbour = (static_cast<uint64_t>(static_cast<uint32_t>(x + dx)) << 32)
+                           | static_cast<uint32_t>(y + dy);
+      auto it = m_cells.find(neighbour);
+      if (it == m_cells.end()) {
+        continue;
+      }
+      for (uint32_t index : it->second) {
+        deliver(index);
+      }
+    }
+  }
+}
+
+TypeId
+KiteRangeNetDevice::GetTypeId()
+{
+  static TypeId tid =
+    TypeId("ns3::ndn::KiteRangeNetDevice")
+      .SetGroupName("Ndn")
+      .SetParent<NetDevice>()
+      .AddConstructor<KiteRangeNetDevice>()
+
+      .AddAttribute("DataRate", "Rate at which frames are put on the air", StringValue("24Mbps"),
+                    MakeDataRateAccessor(&KiteRangeNetDevice::m_dataRate), MakeDataRateChecker())
+      .AddAttribute("MaxQueueDelay", "Frames that would wait longer than this to be sent are dropped",
+                    StringValue("100ms"),
+                    MakeTimeAccessor(&KiteRangeNetDevice::m_maxQueueDelay), MakeTimeChecker())
+      .AddAttribute("Mtu", "MAC-level Maximum Transmission Unit", UintegerValue(2296),
+                    MakeUintegerAccessor(&KiteRangeNetDevice::SetMtu, &KiteRangeNetDevice::GetMtu),
+                    MakeUintegerChecker<uint16_t>())
+
+      .AddTraceSource("Drop", "A frame was dropped because the send queue was too long",
+                      MakeTraceSourceAccessor(&KiteRangeNetDevice::m_dropTrace),
+                      "ns3::Packet::TracedCallback");
+
+  return tid;
+}
+
+KiteRangeNetDevice::KiteRangeNetDevice()
+  : m_address(Mac48Address::Allocate())
+  , m_ifIndex(0)
+  , m_mtu(2296)
+{
+}
+
+void
+KiteRangeNetDevice::DoDispose()
+{
+  m_node = nullptr;
+  m_channel = nullptr;
+  m_rxCallback.Nullify();
+  m_promiscCallback.Nullify();
+
+  NetDevice::DoDispose();
+}
+
+void
+KiteRangeNetDevice::SetChannel(Ptr<KiteRangeChannel> channel)
+{
+  m_channel = channel;
+  m_channel->Add(this);
+}
+
+void
+KiteRangeNetDevice::Receive(Ptr<Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from)
+{
+  NetDevice::PacketType packetType;
+  if (to == m_address) {
+    packetType = NetDevice::PACKET_HOST;
+  }
+  else if (to.IsBroadcast()) {
+    packetType = NetDevice::PACKET_BROADCAST;
+  }
+  else if (to.IsGroup()) {
+    packetType = NetDevice::PACKET_MULTICAST;
+  }
+  else {
+    packetType = NetDevice::PACKET_OTHERHOST;
+  }
+
+  if (!m_promiscCallback.IsNull()) {
+    m_promiscCallback(this, packet, protocol, from, to, packetType);
+  }
+  if (packetType != NetDevice::PACKET_OTHERHOST) {
+    m_rxCallback(this, packet, protocol, from);
+  }
+}
+
+bool
+KiteRangeNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  return SendFrom(packet, m_address, dest, protocolNumber);
+}
+
+bool
+KiteRangeNetDevice::SendFrom(Ptr<Packet> packet, const Address& source, const Address& dest,
+                             uint16_t protocolNumber)
+{
+  // frames leave one after another at DataRate, as a MAC without contention would send them
+  Time now = Simulator::Now();
+  Time start = std::max(now, m_txFree);
+  if (start - now > m_maxQueueDelay) {
+    m_dropTrace(packet);
+    return false;
+  }
+  m_txFree = start + m_dataRate.CalculateBytesTxTime(packet->GetSize());
+
+  m_channel->Send(packet, protocolNumber, Mac48Address::ConvertFrom(dest), Mac48Address::ConvertFrom(source),
+                  this, m_txFree - now);
+  return true;
+}
+
+void
+KiteRangeNetDevice::SetIfIndex(const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+uint32_t
+KiteRangeNetDevice::GetIfIndex() const
+{
+  return m_ifIndex;
+}
+
+Ptr<Channel>
+KiteRangeNetDevice::GetChannel() const
+{
+  return m_channel;
+}
+
+void
+KiteRangeNetDevice::SetAddress(Address address)
+{
+  m_address = Mac48Address::ConvertFrom(address);
+}
+
+Address
+KiteRangeNetDevice::GetAddress() const
+{
+  return m_address;
+}
+
+bool
+KiteRangeNetDevice::SetMtu(const uint16_t mtu)
+{
+  m_mtu = mtu;
+  return true;
+}
+
+uint16_t
+KiteRangeNetDevice::GetMtu() const
+{
+  return m_mtu;
+}
+
+bool
+KiteRangeNetDevice::IsLinkUp() const
+{
+  return true;
+}
+
+void
+KiteRangeNetDevice::AddLinkChangeCallback(Callback<void> callback)
+{
+  // the link is always up
+}
+
+bool
+KiteRangeNetDevice::IsBroadcast() const
+{
+  return true;
+}
+
+Address
+KiteRangeNetDevice::GetBroadcast() const
+{
+  return Mac48Address::GetBroadcast();
+}
+
+bool
+KiteRangeNetDevice::IsMulticast() const
+{
+  return true;
+}
+
+Address
+KiteRangeNetDevice::GetMulticast(Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast(multicastGroup);
+}
+
+Address
+KiteRangeNetDevice::GetMulticast(Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast(addr);
+}
+
+bool
+KiteRangeNetDevice::IsBridge() const
+{
+  return false;
+}
+
+bool
+KiteRangeNetDevice::IsPointToPoint() const
+{
+  return false;
+}
+
+Ptr<Node>
+KiteRangeNetDevice::GetNode() const
+{
+  return m_node;
+}
+
+void
+KiteRangeNetDevice::SetNode(Ptr<Node> node)
+{
+  m_node = node;
+}
+
+bool
+KiteRangeNetDevice::NeedsArp() const
+{
+  return false;
+}
+
+void
+KiteRangeNetDevice::SetReceiveCallback(NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+KiteRangeNetDevice::SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscCallback = cb;
+}
+
+bool
+KiteRangeNetDevice::SupportsSendFrom() const
+{
+  return true;
+}
+
+KiteRangeHelper::KiteRangeHelper()
+{
+  m_channelFactory.SetTypeId("ns3::ndn::KiteRangeChannel");
+  m_deviceFactory.SetTypeId("ns3::ndn::KiteRangeNetDevice");
+}
+
+void
+KiteRangeHelper::SetChannelAttribute(const std::string& name, const AttributeValue& value)
+{
+  m_channelFactory.Set(name, value);
+}
+
+void
+KiteRangeHelper::SetDeviceAttribute(const std::string& name, const AttributeValue& value)
+{
+  m_deviceFactory.Set(name, value);
+}
+
+Ptr<KiteRangeChannel>
+KiteRangeHelper::CreateChannel() const
+{
+  return m_channelFactory.Create<KiteRangeChannel>();
+}
+
+NetDeviceContainer
+KiteRangeHelper::Install(const NodeContainer& nodes, Ptr<KiteRangeChannel> channel) const
+{
+  NetDeviceContainer devices;
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr<KiteRangeNetDevice> device = m_deviceFactory.Create<KiteRangeNetDevice>();
+    nodes.Get(i)->AddDevice(device);
+    device->SetChannel(channel);
+    devices.Add(device);
+  }
+  return devices;
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,268 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_RANGE_CHANNEL_H
+#define NDN_KITE_RANGE_CHANNEL_H
+
+#include "ns3/channel.h"
+#include "ns3/net-device.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/mac48-address.h"
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+#include "ns3/object-factory.h"
+#include "ns3/event-id.h"
+#include "ns3/mobility-model.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+class KiteRangeNetDevice;
+
+/**
+ * @brief Shared wireless medium without a PHY: a frame reaches every device within range
+ *
+ * Devices closer than Range always receive, devices between Range and Range + FadeRange receive with a
+ * probability falling linearly to 0, others never do. Every frame is then dropped with LossRate.
+ * There are no collisions, interference or MAC retransmissions, which is what makes the channel cheap
+ * enough for thousands of mobiles; use YANS when those effects matter.
+ *
+ * Devices are binned into square cells of side Range + FadeRange, so a frame is only checked against the
+ * devices of the 3 x 3 cells around its sender. Bins follow the CourseChange of the mobility models,
+ * and a moving device is re-binned when its current course takes it across a cell border.
+ */
+class KiteRangeChannel : public Channel {
+public:
+  static TypeId
+  GetTypeId();
+
+  KiteRangeChannel();
+
+  void
+  Add(Ptr<KiteRangeNetDevice> device);
+
+  /**
+   * @brief Delivers @p packet to the devices in range of @p sender, once it is on the air for @p txTime
+   */
+  void
+  Send(Ptr<const Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from,
+       Ptr<KiteRangeNetDevice> sender, Time txTime);
+
+  // inherited from Channel
+  virtual uint32_t
+  GetNDevices() const;
+
+  virtual Ptr<NetDevice>
+  GetDevice(uint32_t i) const;
+
+  int64_t
+  AssignStreams(int64_t stream);
+
+public: // statistics
+  uint64_t
+  GetFrameCount() const
+  {
+    return m_nFrames;
+  }
+
+  /**
+   * @brief Number of receivers whose distance to the sender was computed
+   */
+  uint64_t
+  GetCandidateCount() const
+  {
+    return m_nCandidates;
+  }
+
+private:
+  bool
+  IsReceived(double distance) const;
+
+  uint64_t
+  GetCell(const Vector& position) const;
+
+  void
+  OnCourseChange(Ptr<const MobilityModel> model);
+
+  /**
+   * @brief Moves device @p index to the cell it is in now, and schedules its next move
+   */
+  void
+  Rebin(uint32_t index);
+
+private:
+  double m_range;
+  double m_fadeRange;
+  double m_lossRate;
+  Time m_delay;
+  bool m_useSpatialIndex;
+  Ptr<UniformRandomVariable> m_random;
+
+  std::vector<Ptr<KiteRangeNetDevice>> m_devices;
+  std::vector<Ptr<MobilityModel>> m_mobilities; // by device index
+  std::vector<uint64_t> m_deviceCells;          // by device index
+  std::vector<EventId> m_rebinEvents;           // by device index
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;       // device indices by cell
+  std::unordered_map<uint32_t, std::vector<uint32_t>> m_nodeDevices; // device indices by node ID
+
+  uint64_t m_nFrames;
+  uint64_t m_nCandidates;
+};
+
+/**
+ * @brief NetDevice of a KiteRangeChannel, sending frames one after another at a fixed DataRate
+ */
+class KiteRangeNetDevice : public NetDevice {
+public:
+  static TypeId
+  GetTypeId();
+
+  KiteRangeNetDevice();
+
+  void
+  SetChannel(Ptr<KiteRangeChannel> channel);
+
+  /**
+   * @brief Called by the channel when a frame of another device reaches this one
+   */
+  void
+  Receive(Ptr<Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from);
+
+  // inherited from NetDevice
+  virtual void
+  SetIfIndex(const uint32_t index);
+
+  virtual uint32_t
+  GetIfIndex() const;
+
+  virtual Ptr<Channel>
+  GetChannel() const;
+
+  virtual void
+  SetAddress(Address address);
+
+  virtual Address
+  GetAddress() const;
+
+  virtual bool
+  SetMtu(const uint16_t mtu);
+
+  virtual uint16_t
+  GetMtu() const;
+
+  virtual bool
+  IsLinkUp() const;
+
+  virtual void
+  AddLinkChangeCallback(Callback<void> callback);
+
+  virtual bool
+  IsBroadcast() const;
+
+  virtual Address
+  GetBroadcast() const;
+
+  virtual bool
+  IsMulticast() const;
+
+  virtual Address
+  GetMulticast(Ipv4Address multicastGroup) const;
+
+  virtual Address
+  GetMulticast(Ipv6Address addr) const;
+
+  virtual bool
+  IsBridge() const;
+
+  virtual bool
+  IsPointToPoint() const;
+
+  virtual bool
+  Send(Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+
+  virtual bool
+  SendFrom(Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+
+  virtual Ptr<Node>
+  GetNode() const;
+
+  virtual void
+  SetNode(Ptr<Node> node);
+
+  virtual bool
+  NeedsArp() const;
+
+  virtual void
+  SetReceiveCallback(NetDevice::ReceiveCallback cb);
+
+  virtual void
+  SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb);
+
+  virtual bool
+  SupportsSendFrom() const;
+
+protected:
+  virtual void
+  DoDispose();
+
+private:
+  Ptr<Node> m_node;
+  Ptr<KiteRangeChannel> m_channel;
+  Mac48Address m_address;
+  uint32_t m_ifIndex;
+  uint16_t m_mtu;
+  DataRate m_dataRate;
+  Time m_maxQueueDelay;
+  Time m_txFree; // when the frames already sent are all on the air
+
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscCallback;
+  TracedCallback<Ptr<const Packet>> m_dropTrace;
+};
+
+/**
+ * @brief Puts nodes on a KiteRangeChannel
+ *
+ * Usage:
+ *
+ *     ndn::KiteRangeHelper range;
+ *     range.SetChannelAttribute("Range", DoubleValue(50));
+ *     Ptr<ndn::KiteRangeChannel> channel = range.CreateChannel();
+ *     range.Install(accessRouters, channel);
+ *     range.Install(mobiles, channel);
+ */
+class KiteRangeHelper {
+public:
+  KiteRangeHelper();
+
+  void
+  SetChannelAttribute(const std::string& name, const AttributeValue& value);
+
+  void
+  SetDeviceAttribute(const std::string& name, const AttributeValue& value);
+
+  Ptr<KiteRangeChannel>
+  CreateChannel() const;
+
+  NetDeviceContainer
+  Install(const NodeContainer& nodes, Ptr<KiteRangeChannel> channel) const;
+
+private:
+  ObjectFactory m_channelFactory;
+  ObjectFactory m_deviceFactory;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_RANGE_CHANNEL_H
@@ -0,0 +1,202 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-replicator.h"
+
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteReplicator");
+
+namespace ns3 {
+namespace ndn {
+
+KiteReplicator::KiteReplicator()
+  : m_firstRun(1)
+  , m_nRuns(1)
+  , m_nJobs(std::max(std::thread::hardware_concurrency(), 1u))
+  , m_replica(0)
+  , m_nFailed(0)
+{
+}
+
+void
+KiteReplicator::SetRuns(uint32_t first, uint32_t count)
+{
+  m_firstRun = first;
+  m_nRuns = std::max(count, 1u);
+}
+
+void
+KiteReplicator::SetJobs(uint32_t jobs)
+{
+  m_nJobs = std::max(jobs, 1u);
+}
+
+void
+KiteReplicator::Vary(const std::string& path, const std::vector<std::string>& values)
+{
+  if (values.empty()) {
+    NS_FATAL_ERROR("No value to vary " << path << " over");
+  }
+  m_parameters.push_back({path, values});
+}
+
+void
+KiteReplicator::Vary(const std::string& spec)
+{
+  std::istringstream is(spec);
+  std::string parameter;
+  while (std::getline(is, parameter, ';')) {
+    if (parameter.empty()) {
+      continue;
+    }
+    size_t equal = parameter.find('=');
+    if (equal == std::string::npos) {
+      NS_FATAL_ERROR("Expected path=value,value in " << parameter);
+    }
+
+    std::vector<std::string> values;
+    std::istringstream valueIs(parameter.substr(equal + 1));
+    std::string value;
+    while (std::getline(valueIs, value, ',')) {
+      values.push_back(value);
+    }
+    Vary(parameter.substr(0, equal), values);
+  }
+}
+
+uint32_t
+KiteReplicator::GetReplicaCount() const
+{
+  uint32_t count = m_nRuns;
+  for (const Parameter& parameter : m_parameters) {
+    count *= parameter.values.size();
+  }
+  return count;
+}
+
+bool
+KiteReplicator::Fork()
+{
+  // whatever is still buffered would be written once by every replica
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+
+  uint32_t nReplicas = GetReplicaCount();
+  std::map<pid_t, uint32_t> running; // replica by child
+  uint32_t next = 0;
+  while (next < nReplicas || !running.empty()) {
+    if (next < nReplicas && running.size() < m_nJobs) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        NS_FATAL_ERROR("Cannot fork replica " << next << ": " << std::strerror(errno));
+      }
+      if (pid == 0) {
+        Enter(next);
+        return true;
+      }
+      running[pid] = next++;
+      continue;
+    }
+
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      NS_FATAL_ERROR("Cannot wait for the replicas: " << std::strerror(errno));
+    }
+    auto child = running.find(pid);
+    if (child == running.end()) {
+      continue;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      m_nFailed++;
+      std::cerr << "replica " << child->second << " failed" << std::endl;
+    }
+    NS_LOG_INFO("Replica " << child->second << " exited, " << running.size() - 1 << " still running");
+    running.erase(child);
+  }
+  return false;
+}
+
+void
+KiteReplicator::Enter(uint32_t replica)
+{
+  m_replica = replica;
+  RngSeedManager::SetRun(GetRun());
+
+  std::vector<size_t> indices = GetValueIndices();
+  for (size_t i = 0; i < m_parameters.size(); ++i) {
+    Config::Set(m_parameters[i].path, StringValue(m_parameters[i].values[indices[i]]));
+  }
+  NS_LOG_INFO("Replica " << m_replica << ": run " << GetRun());
+}
+
+uint32_t
+KiteReplicator::GetRun() const
+{
+  return m_firstRun + m_replica % m_nRuns;
+}
+
+std::vector<size_t>
+KiteReplicator::GetValueIndices() const
+{
+  // run numbers vary fastest, then the first attribute
+  std::vector<size_t> indices;
+  uint32_t rest = m_replica / m_nRuns;
+  for (const Parameter& parameter : m_parameters) {
+    indices.push_back(rest % parameter.values.size());
+    rest /= parameter.values.size();
+  }
+  return indices;
+}
+
+std::vector<std::pair<std::string, std::string>>
+KiteReplicator::GetValues() const
+{
+  std::vector<std::pair<std::string, std::string>> values;
+  std::vector<size_t> indices = GetValueIndices();
+  for (size_t i = 0; i < m_parameters.size(); ++i) {
+    const std::string& path = m_parameters[i].path;
+    values.emplace_back(path.substr(path.find_last_of('/') + 1), m_parameters[i].values[indices[i]]);
+  }
+  return values;
+}
+
+std::string
+KiteReplicator::GetFileName(const std::string& filename) const
+{
+  size_t dot = filename.find_last_of('.');
+  size_t slash = filename.find_last_of('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    dot = filename.size();
+  }
+  return filename.substr(0, dot) + "-" + std::to_string(m_replica) + filename.substr(dot);
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,144 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_REPLICATOR_H
+#define NDN_KITE_REPLICATOR_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Runs several replications of a scenario from a single setup, forking right before Simulator::Run()
+ *
+ * The topology, the stacks and the routes are built once. Each replica is a child process that inherits
+ * the built simulation copy-on-write, applies its own run number (RngRun) and attribute values, and runs it.
+ * Every combination of the varied attributes is run once per run number:
+ *
+ *     ndn::KiteReplicator replicator;
+ *     replicator.SetRuns(1, 10);
+ *     replicator.Vary(traceOnMovePath, {"false", "true"}); // a Config path of the mobile applications
+ *     ... build the scenario ...
+ *     if (!replicator.Fork()) {
+ *       return replicator.GetFailedCount() == 0 ? 0 : 1; // all 20 replicas have exited
+ *     }
+ *     mobility.AssignStreams(mobiles, 0); // draw from the streams of this run
+ *     Simulator::Run();
+ *
+ * Random variables created during setup keep the streams of the setup run unless the replica reassigns
+ * them, and whatever setup has already drawn (random topologies, initial positions) is shared by all replicas.
+ */
+class KiteReplicator {
+public:
+  KiteReplicator();
+
+  /**
+   * @brief Replicates over the run numbers @p first to @p first + @p count - 1
+   */
+  void
+  SetRuns(uint32_t first, uint32_t count);
+
+  /**
+   * @brief Number of replicas running at the same time, the number of cores by default
+   */
+  void
+  SetJobs(uint32_t jobs);
+
+  /**
+   * @brief Replicates over the values of the attributes matching a Config path
+   */
+  void
+  Vary(const std::string& path, const std::vector<std::string>& values);
+
+  /**
+   * @brief Adds the attributes of a "path=value,value;path=value,value" list, as given on the command line
+   */
+  void
+  Vary(const std::string& spec);
+
+  uint32_t
+  GetReplicaCount() const;
+
+  /**
+   * @brief Forks the replicas, at most Jobs at a time
+   *
+   * @return true in a replica, once its run number and attribute values are set;
+   *         false in the parent, once all replicas have exited
+   */
+  bool
+  Fork();
+
+  /**
+   * @brief Index of this replica, in [0, GetReplicaCount())
+   */
+  uint32_t
+  GetReplica() const
+  {
+    return m_replica;
+  }
+
+  uint32_t
+  GetRun() const;
+
+  /**
+   * @brief Attribute name (the last component of its path) and value of every varied attribute of this replica
+   */
+  std::vector<std::pair<std::string, std::string>>
+  GetValues() const;
+
+  /**
+   * @brief @p filename with the replica index before its extension, e.g., metrics.json becomes metrics-3.json
+   */
+  std::string
+  GetFileName(const std::string& filename) const;
+
+  /**
+   * @brief Replicas that did not exit with status 0, valid in the parent once Fork() returned
+   */
+  uint32_t
+  GetFailedCount() const
+  {
+    return m_nFailed;
+  }
+
+private:
+  /**
+   * @brief Index into the values of each varied attribute for this replica
+   */
+  std::vector<size_t>
+  GetValueIndices() const;
+
+  /**
+   * @brief Sets the run number and the attribute values of replica @p replica, in the child
+   */
+  void
+  Enter(uint32_t replica);
+
+private:
+  struct Parameter
+  {
+    std::string path;
+    std::vector<std::string> values;
+  };
+
+  uint32_t m_firstRun;
+  uint32_t m_nRuns;
+  uint32_t m_nJobs;
+  std::vector<Parameter> m_parameters;
+
+  uint32_t m_replica;
+  uint32_t m_nFailed;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_REPLICATOR_H
@@ -0,0 +1,117 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-request-signer.h"
+
+#include <ndn-cxx/signature-info.hpp>
+#include <ndn-cxx/encoding/block-helpers.hpp>
+
+namespace ns3 {
+namespace ndn {
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t
+fnv1a(uint64_t hash, const uint8_t* begin, const uint8_t* end)
+{
+  for (const uint8_t* i = begin; i != end; ++i) {
+    hash ^= *i;
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+uint64_t
+fnv1a(uint64_t hash, const Name& name)
+{
+  const ::ndn::Block& wire = name.wireEncode();
+  return fnv1a(hash, wire.wire(), wire.wire() + wire.size());
+}
+
+} // anonymous namespace
+
+Name
+KiteRequestSigner::GetKeyName(const Name& mobilePrefix, uint64_t epoch)
+{
+  return Name(mobilePrefix).append("KEY").appendVersion(epoch);
+}
+
+uint64_t
+KiteRequestSigner::ComputeTag(const Name& keyName, const Name& unsignedName, const Name& traceName)
+{
+  // stands in for the private key: anyone can compute it, but nobody in the simulation tries
+  uint64_t secret = fnv1a(FNV_OFFSET ^ 0x6b697465, keyName);
+
+  uint64_t tag = fnv1a(secret, unsignedName);
+  return fnv1a(tag, traceName);
+}
+
+void
+KiteRequestSigner::Sign(Interest& request, const Name& keyName)
+{
+  ::ndn::SignatureInfo signatureInfo(static_cast< ::ndn::tlv::SignatureTypeValue>(SIGNATURE_TYPE),
+                                     ::ndn::KeyLocator(keyName));
+
+  uint64_t tag = ComputeTag(keyName, request.getName(), request.getTraceName());
+
+  Name name(request.getName());
+  name.append(signatureInfo.wireEncode());
+  name.append(::ndn::makeNonNegativeIntegerBlock(::ndn::tlv::SignatureValue, tag));
+  request.setName(name);
+}
+
+bool
+KiteRequestSigner::Parse(const Interest& request, Name& keyName, uint64_t& tag)
+{
+  const Name& name = request.getName();
+  if (name.size() < 2) {
+    return false;
+  }
+
+  try {
+    ::ndn::SignatureInfo signatureInfo(name[-2].blockFromValue());
+    if (signatureInfo.getSignatureType() != SIGNATURE_TYPE || !signatureInfo.hasKeyLocator()
+        || signatureInfo.getKeyLocator().getType() != ::ndn::KeyLocator::KeyLocator_Name) {
+      return false;
+    }
+
+    ::ndn::Block value = name[-1].blockFromValue();
+    if (value.type() != ::ndn::tlv::SignatureValue) {
+      return false;
+    }
+
+    keyName = signatureInfo.getKeyLocator().getName();
+    tag = ::ndn::readNonNegativeInteger(value);
+  }
+  catch (const ::ndn::tlv::Error&) {
+    return false;
+  }
+  return true;
+}
+
+bool
+KiteRequestSigner::Verify(const Interest& request)
+{
+  Name keyName;
+  uint64_t tag;
+  if (!Parse(request, keyName, tag)) {
+    return false;
+  }
+
+  // a mobile may only request uploads of its own data
+  if (!request.getTraceName().isPrefixOf(keyName)) {
+    return false;
+  }
+
+  return tag == ComputeTag(keyName, request.getName().getPrefix(-2), request.getTraceName());
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,65 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_REQUEST_SIGNER_H
+#define NDN_KITE_REQUEST_SIGNER_H
+
+#include "ns3/ndnSIM/model/ndn-common.hpp"
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Signs and verifies Kite upload requests (flag 1)
+ *
+ * A signed request name is <request name>/<SignatureInfo>/<SignatureValue>, as for ndn-cxx signed Interests.
+ * Real signatures cost nothing in a simulation but would hide the cost we care about, so the value is
+ * a keyed FNV-1a tag over the request name and the TraceName, under a key named <mobile prefix>/KEY/<epoch>.
+ * The tag has no timestamp or nonce, so a mobile's requests are identical within a key epoch,
+ * which is what lets the server cache verification results.
+ */
+class KiteRequestSigner {
+public:
+  /**
+   * @brief Signature type of the simulated tag, from the experimental range
+   */
+  static const uint32_t SIGNATURE_TYPE = 200;
+
+  /**
+   * @brief Name of the key a mobile uses in a key epoch
+   */
+  static Name
+  GetKeyName(const Name& mobilePrefix, uint64_t epoch);
+
+  /**
+   * @brief Appends SignatureInfo and SignatureValue components to the name of a request
+   */
+  static void
+  Sign(Interest& request, const Name& keyName);
+
+  /**
+   * @brief Extracts key name and tag of a signed request
+   * @return false if the request is not signed with SIGNATURE_TYPE
+   */
+  static bool
+  Parse(const Interest& request, Name& keyName, uint64_t& tag);
+
+  /**
+   * @brief Checks the tag of a signed request, and that its key belongs to the mobile named by the TraceName
+   */
+  static bool
+  Verify(const Interest& request);
+
+private:
+  static uint64_t
+  ComputeTag(const Name& keyName, const Name& unsignedName, const Name& traceName);
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_REQUEST_SIGNER_H
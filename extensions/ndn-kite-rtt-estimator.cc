@@ -0,0 +1,66 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-rtt-estimator.h"
+
+#include <algorithm>
+
+namespace ns3 {
+namespace ndn {
+
+KiteRttEstimator::KiteRttEstimator(Time initialRto, Time minRto, Time maxRto)
+  : m_initialRto(initialRto)
+  , m_minRto(minRto)
+  , m_maxRto(maxRto)
+{
+  Reset();
+}
+
+void
+KiteRttEstimator::AddSample(Time rtt)
+{
+  if (!m_hasSample) {
+    m_srtt = rtt;
+    m_rttVar = rtt / 2;
+    m_hasSample = true;
+  }
+  else {
+    Time delta = m_srtt > rtt ? m_srtt - rtt : rtt - m_srtt;
+    m_rttVar = (m_rttVar * 3 + delta) / 4;
+    m_srtt = (m_srtt * 7 + rtt) / 8;
+  }
+
+  m_rto = m_srtt + m_rttVar * 4;
+  m_backoff = 1;
+}
+
+void
+KiteRttEstimator::Backoff()
+{
+  if (m_rto * m_backoff < m_maxRto) {
+    m_backoff *= 2;
+  }
+}
+
+void
+KiteRttEstimator::Reset()
+{
+  m_hasSample = false;
+  m_srtt = Time(0);
+  m_rttVar = Time(0);
+  m_rto = m_initialRto;
+  m_backoff = 1;
+}
+
+Time
+KiteRttEstimator::GetRto() const
+{
+  return std::min(std::max(m_rto * m_backoff, m_minRto), m_maxRto);
+}
+
+} // namespace ndn
+} // namespace ns3
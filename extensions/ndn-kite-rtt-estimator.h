@@ -0,0 +1,74 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_RTT_ESTIMATOR_H
+#define NDN_KITE_RTT_ESTIMATOR_H
+
+#include "ns3/nstime.h"
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Jacobson/Karels RTT estimator with exponential backoff for one upload session
+ *
+ * Callers follow Karn's rule: only segments that were sent once are sampled.
+ * Reset() drops all history, e.g., when the mobile moved and the trace path changed length.
+ */
+class KiteRttEstimator {
+public:
+  KiteRttEstimator(Time initialRto, Time minRto, Time maxRto);
+
+  /**
+   * @brief Adds an RTT sample and clears the backoff
+   */
+  void
+  AddSample(Time rtt);
+
+  /**
+   * @brief Doubles the retransmission timeout, up to the maximum
+   */
+  void
+  Backoff();
+
+  /**
+   * @brief Forgets all samples, the timeout goes back to the initial one
+   */
+  void
+  Reset();
+
+  Time
+  GetRto() const;
+
+  Time
+  GetSrtt() const
+  {
+    return m_srtt;
+  }
+
+  bool
+  HasSample() const
+  {
+    return m_hasSample;
+  }
+
+private:
+  Time m_initialRto;
+  Time m_minRto;
+  Time m_maxRto;
+
+  bool m_hasSample;
+  Time m_srtt;
+  Time m_rttVar;
+  Time m_rto;
+  uint32_t m_backoff;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_RTT_ESTIMATOR_H
@@ -0,0 +1,827 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-topology.h"
+
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/data-rate.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/channel.h"
+#include "ns3/string.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/position-allocator.h"
+#include "ns3/rectangle.h"
+
+#include "ns3/ndnSIM/helper/ndn-fib-helper.hpp"
+#include "ns3/ndnSIM/helper/ndn-strategy-choice-helper.hpp"
+#include "ns3/ndnSIM/model/ndn-l3-protocol.hpp"
+
+#include "trace-forwarding.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteTopologyBuilder");
+
+namespace ns3 {
+namespace ndn {
+
+namespace {
+
+uint32_t
+findRoot(std::vector<uint32_t>& parents, uint32_t i)
+{
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
+const char BINARY_MAGIC[4] = {'K', 'T', 'O', 'P'};
+const uint32_t BINARY_VERSION = 1;
+
+} // anonymous namespace
+
+KiteTopologyBuilder::KiteTopologyBuilder()
+  : m_type("grid")
+  , m_nRouters(9)
+  , m_treeDegree(2)
+  , m_spacing(100)
+  , m_radius(0)
+  , m_accessDensity(1.0)
+  , m_nSystems(1)
+{
+}
+
+void
+KiteTopologyBuilder::SetTopology(const std::string& type)
+{
+  if (type != "grid" && type != "tree" && type != "rgg") {
+    NS_FATAL_ERROR("Unknown topology " << type << ", expected grid, tree or rgg");
+  }
+  m_type = type;
+}
+
+void
+KiteTopologyBuilder::SetRouterCount(uint32_t nRouters)
+{
+  m_nRouters = std::max<uint32_t>(nRouters, 1);
+}
+
+void
+KiteTopologyBuilder::SetTreeDegree(uint32_t degree)
+{
+  m_treeDegree = std::max<uint32_t>(degree, 1);
+}
+
+void
+KiteTopologyBuilder::SetSpacing(double spacing)
+{
+  m_spacing = spacing;
+}
+
+void
+KiteTopologyBuilder::SetRadius(double radius)
+{
+  m_radius = radius;
+}
+
+void
+KiteTopologyBuilder::SetAccessDensity(double density)
+{
+  m_accessDensity = std::min(std::max(density, 0.0), 1.0);
+}
+
+void
+KiteTopologyBuilder::SetSystemCount(uint32_t count)
+{
+  m_nSystems = std::max<uint32_t>(count, 1);
+}
+
+void
+KiteTopologyBuilder::Build(PointToPointHelper& p2p)
+{
+  if (m_type == "grid") {
+    BuildGrid();
+  }
+  else if (m_type == "tree") {
+    BuildTree();
+  }
+  else if (m_type == "rgg") {
+    BuildRandomGeometric();
+  } // else loaded from a file
+  Partition();
+
+  m_server = CreateObject<Node>(m_systemIds[0]);
+  for (uint32_t systemId : m_systemIds) {
+    m_routers.Add(CreateObject<Node>(systemId));
+  }
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+  for (const Vector& position : m_positions) {
+    positions->Add(position);
+  }
+  mobility.SetPositionAllocator(positions);
+  mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+  mobility.Install(m_routers);
+  for (uint32_t i : m_accessIndices) {
+    m_accessRouters.Add(m_routers.Get(i));
+  }
+
+  positions = CreateObject<ListPositionAllocator>();
+  positions->Add(Vector(m_positions[0].x - m_spacing / 2, m_positions[0].y, 0));
+  mobility.SetPositionAllocator(positions);
+  mobility.Install(m_server);
+
+  p2p.Install(m_server, m_routers.Get(0));
+  // set per-link parameters on the new objects rather than on the helper,
+  // which would go through its attribute factories once per link
+  for (const Link& link : m_links) {
+    NetDeviceContainer devices = p2p.Install(m_routers.Get(link.a), m_routers.Get(link.b));
+    for (uint32_t i = 0; i < devices.GetN(); ++i) {
+      Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice>(devices.Get(i));
+      if (link.rate != 0) {
+        device->SetDataRate(DataRate(link.rate));
+      }
+      if (link.maxPackets != 0) {
+        device->GetQueue()->SetAttributeFailSafe("MaxPackets", UintegerValue(link.maxPackets));
+      }
+    }
+    if (!link.delay.IsZero()) {
+      devices.Get(0)->GetChannel()->SetAttribute("Delay", TimeValue(link.delay));
+    }
+    if (m_systemIds[link.a] != m_systemIds[link.b]) {
+      TimeValue delay;
+      devices.Get(0)->GetChannel()->GetAttribute("Delay", delay);
+      if (delay.Get().IsZero()) {
+        NS_FATAL_ERROR("Link " << link.a << " - " << link.b << " between ranks has no delay");
+      }
+    }
+  }
+
+  NS_LOG_INFO("Built " << m_type << " backbone: " << m_routers.GetN() << " routers, "
+              << m_links.size() << " links, " << m_accessRouters.GetN() << " access routers");
+}
+
+void
+KiteTopologyBuilder::AddLink(uint32_t a, uint32_t b, uint32_t metric, uint64_t rate, Time delay, uint32_t maxPackets)
+{
+  m_adjacency[a].push_back(m_links.size());
+  m_adjacency[b].push_back(m_links.size());
+  m_links.push_back({a, b, metric, rate, delay, maxPackets});
+}
+
+void
+KiteTopologyBuilder::Load(const std::string& filename)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  std::ifstream is(filename, std::ios::binary);
+  if (!is) {
+    NS_FATAL_ERROR("Cannot open topology file " << filename);
+  }
+
+  char magic[sizeof(BINARY_MAGIC)] = {};
+  is.read(magic, sizeof(magic));
+  bool isBinary = is.gcount() == sizeof(magic) && std::equal(magic, magic + sizeof(magic), BINARY_MAGIC);
+  is.clear();
+  is.seekg(0);
+
+  m_type = "file";
+  m_positions.clear();
+  m_adjacency.clear();
+  m_links.clear();
+  m_accessIndices.clear();
+  if (isBinary) {
+    LoadBinary(is);
+  }
+  else {
+    LoadAnnotated(is);
+  }
+
+  if (m_positions.empty()) {
+    NS_FATAL_ERROR("No router in topology file " << filename);
+  }
+  if (m_accessIndices.empty()) {
+    std::vector<uint32_t> candidates(m_positions.size() - (m_positions.size() > 1 ? 1 : 0));
+    std::iota(candidates.begin(), candidates.end(), m_positions.size() > 1 ? 1 : 0);
+    SelectAccessRouters(candidates);
+  }
+
+  NS_LOG_INFO("Loaded " << m_positions.size() << " routers and " << m_links.size() << " links from " << filename
+              << " in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s");
+}
+
+void
+KiteTopologyBuilder::LoadAnnotated(std::istream& is)
+{
+  std::unordered_map<std::string, uint32_t> indices;
+  enum { NONE, ROUTER, LINK } section = NONE;
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream ls(line);
+    std::string first;
+    if (!(ls >> first) || first[0] == '#') {
+      continue;
+    }
+    if (first == "router") {
+      section = ROUTER;
+      continue;
+    }
+    if (first == "link") {
+      section = LINK;
+      continue;
+    }
+
+    if (section == ROUTER) {
+      std::string comment;
+      double latitude = 0;
+      double longitude = 0;
+      ls >> comment >> latitude >> longitude;
+      if (!indices.emplace(first, m_positions.size()).second) {
+        NS_FATAL_ERROR("Duplicate router " << first);
+      }
+      if (comment == "access") {
+        m_accessIndices.push_back(m_positions.size());
+      }
+      m_positions.emplace_back(longitude, -latitude, 0);
+      m_adjacency.emplace_back();
+    }
+    else if (section == LINK) {
+      std::string to, capacity, delay;
+      uint32_t metric = 1;
+      uint32_t maxPackets = 0;
+      ls >> to >> capacity >> metric >> delay >> maxPackets;
+      auto a = indices.find(first);
+      auto b = indices.find(to);
+      if (a == indices.end() || b == indices.end()) {
+        NS_FATAL_ERROR("Link " << first << " - " << to << " between unknown routers");
+      }
+      AddLink(a->second, b->second, metric, capacity.empty() ? 0 : DataRate(capacity).GetBitRate(),
+              delay.empty() ? Time() : Time(delay), maxPackets);
+    }
+  }
+}
+
+namespace {
+
+template<typename T>
+void
+readValue(std::istream& is, T& value)
+{
+  is.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+template<typename T>
+void
+writeValue(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // anonymous namespace
+
+// binary layout, in host byte order:
+//   magic, uint32_t version, uint32_t nRouters, uint32_t nLinks,
+//   nRouters x {double x, double y, uint8_t isAccess},
+//   nLinks x {uint32_t a, uint32_t b, uint32_t metric, uint64_t rate, int64_t delay ns, uint32_t maxPackets}
+void
+KiteTopologyBuilder::LoadBinary(std::istream& is)
+{
+  is.ignore(sizeof(BINARY_MAGIC));
+  uint32_t version = 0;
+  uint32_t nRouters = 0;
+  uint32_t nLinks = 0;
+  readValue(is, version);
+  readValue(is, nRouters);
+  readValue(is, nLinks);
+  if (!is) {
+    NS_FATAL_ERROR("Truncated binary topology");
+  }
+  if (version != BINARY_VERSION) {
+    NS_FATAL_ERROR("Unsupported binary topology version " << version);
+  }
+
+  // a corrupt header must not make us allocate for routers and links the file cannot hold
+  const uint64_t routerSize = 2 * sizeof(double) + sizeof(uint8_t);
+  const uint64_t linkSize = 4 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+  std::streampos dataStart = is.tellg();
+  is.seekg(0, std::ios::end);
+  std::streampos dataEnd = is.tellg();
+  is.seekg(dataStart);
+  if (!is || static_cast<uint64_t>(dataEnd - dataStart) < nRouters * routerSize + nLinks * linkSize) {
+    NS_FATAL_ERROR("Truncated binary topology: " << nRouters << " routers and " << nLinks << " links announced, "
+                   << dataEnd - dataStart << " bytes left");
+  }
+
+  m_positions.resize(nRouters);
+  m_adjacency.assign(nRouters, std::vector<uint32_t>());
+  for (uint32_t i = 0; i < nRouters; ++i) {
+    uint8_t isAccess = 0;
+    readValue(is, m_positions[i].x);
+    readValue(is, m_positions[i].y);
+    readValue(is, isAccess);
+    if (isAccess) {
+      m_accessIndices.push_back(i);
+    }
+  }
+
+  m_links.reserve(nLinks);
+  for (uint32_t i = 0; i < nLinks; ++i) {
+    uint32_t a = 0, b = 0, metric = 0, maxPackets = 0;
+    uint64_t rate = 0;
+    int64_t delay = 0;
+    readValue(is, a);
+    readValue(is, b);
+    readValue(is, metric);
+    readValue(is, rate);
+    readValue(is, delay);
+    readValue(is, maxPackets);
+    if (a >= nRouters || b >= nRouters) {
+      NS_FATAL_ERROR("Link " << i << " between unknown routers");
+    }
+    AddLink(a, b, metric, rate, NanoSeconds(delay), maxPackets);
+  }
+
+  if (!is) {
+    NS_FATAL_ERROR("Truncated binary topology");
+  }
+}
+
+void
+KiteTopologyBuilder::Save(const std::string& filename) const
+{
+  std::ofstream os(filename, std::ios::binary);
+  if (!os) {
+    NS_FATAL_ERROR("Cannot open topology file " << filename);
+  }
+
+  std::vector<bool> isAccess(m_positions.size(), false);
+  for (uint32_t i : m_accessIndices) {
+    isAccess[i] = true;
+  }
+
+  os.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  writeValue(os, BINARY_VERSION);
+  writeValue(os, static_cast<uint32_t>(m_positions.size()));
+  writeValue(os, static_cast<uint32_t>(m_links.size()));
+  for (uint32_t i = 0; i < m_positions.size(); ++i) {
+    writeValue(os, m_positions[i].x);
+    writeValue(os, m_positions[i].y);
+    writeValue(os, static_cast<uint8_t>(isAccess[i]));
+  }
+  for (const Link& link : m_links) {
+    writeValue(os, link.a);
+    writeValue(os, link.b);
+    writeValue(os, link.metric);
+    writeValue(os, link.rate);
+    writeValue(os, static_cast<int64_t>(link.delay.GetNanoSeconds()));
+    writeValue(os, link.maxPackets);
+  }
+}
+
+void
+KiteTopologyBuilder::BuildGrid()
+{
+  uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_nRouters))));
+  uint32_t n = side * side;
+  m_positions.resize(n);
+  m_adjacency.assign(n, std::vector<uint32_t>());
+
+  for (uint32_t row = 0; row < side; ++row) {
+    for (uint32_t col = 0; col < side; ++col) {
+      uint32_t i = row * side + col;
+      m_positions[i] = Vector(col * m_spacing, row * m_spacing, 0);
+      if (col + 1 < side) {
+        AddLink(i, i + 1);
+      }
+      if (row + 1 < side) {
+        AddLink(i, i + side);
+      }
+    }
+  }
+
+  std::vector<uint32_t> candidates(n - (n > 1 ? 1 : 0));
+  std::iota(candidates.begin(), candidates.end(), n > 1 ? 1 : 0);
+  SelectAccessRouters(candidates);
+}
+
+void
+KiteTopologyBuilder::BuildTree()
+{
+  uint32_t n = m_nRouters;
+  m_positions.resize(n);
+  m_adjacency.assign(n, std::vector<uint32_t>());
+
+  // router i has children degree * i + 1 .. degree * i + degree, laid out layer by layer
+  uint64_t layerStart = 0;
+  uint64_t layerSize = 1;
+  std::vector<uint32_t> layerStarts;
+  while (layerStart < n) {
+    layerStarts.push_back(layerStart);
+    layerStart += layerSize;
+    layerSize *= m_treeDegree;
+  }
+  uint32_t lastLayerSize = n - layerStarts.back();
+  double width = std::max<uint32_t>(lastLayerSize, 1) * m_spacing;
+
+  std::vector<uint32_t> leaves;
+  uint64_t fullSize = 1;
+  for (uint32_t depth = 0; depth < layerStarts.size(); ++depth, fullSize *= m_treeDegree) {
+    uint32_t begin = layerStarts[depth];
+    uint32_t end = depth + 1 < layerStarts.size() ? layerStarts[depth + 1] : n;
+    for (uint32_t i = begin; i < end; ++i) {
+      double x = (i - begin + 0.5) * width / fullSize - width / 2;
+      m_positions[i] = Vector(x, depth * m_spacing, 0);
+      if (i > 0) {
+        AddLink((i - 1) / m_treeDegree, i);
+      }
+      if (static_cast<uint64_t>(i) * m_treeDegree + 1 >= n) {
+        leaves.push_back(i);
+      }
+    }
+  }
+
+  SelectAccessRouters(leaves);
+}
+
+void
+KiteTopologyBuilder::BuildRandomGeometric()
+{
+  uint32_t n = m_nRouters;
+  double side = std::sqrt(static_cast<double>(n)) * m_spacing;
+  double radius = m_radius > 0 ? m_radius : 1.5 * m_spacing;
+  m_positions.resize(n);
+  m_adjacency.assign(n, std::vector<uint32_t>());
+
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable>();
+  for (uint32_t i = 0; i < n; ++i) {
+    m_positions[i] = Vector(random->GetValue(0, side), random->GetValue(0, side), 0);
+  }
+
+  // buckets of radius x radius, so only the 3 x 3 neighbouring buckets hold link candidates
+  typedef std::pair<int64_t, int64_t> Cell;
+  std::map<Cell, std::vector<uint32_t>> cells;
+  for (uint32_t i = 0; i < n; ++i) {
+    Cell cell(static_cast<int64_t>(m_positions[i].x / radius), static_cast<int64_t>(m_positions[i].y / radius));
+    cells[cell].push_back(i);
+  }
+
+  std::vector<uint32_t> parents(n);
+  std::iota(parents.begin(), parents.end(), 0);
+  for (uint32_t i = 0; i < n; ++i) {
+    int64_t cx = static_cast<int64_t>(m_positions[i].x / radius);
+    int64_t cy = static_cast<int64_t>(m_positions[i].y / radius);
+    for (int64_t dx = -1; dx <= 1; ++dx) {
+      for (int64_t dy = -1; dy <= 1; ++dy) {
+        auto it = cells.find(Cell(cx + dx, cy + dy));
+        if (it == cells.end()) {
+          continue;
+        }
+        for (uint32_t j : it->second) {
+          if (j > i && CalculateDistance(m_positions[i], m_positions[j]) < radius) {
+            AddLink(i, j);
+            parents[findRoot(parents, j)] = findRoot(parents, i);
+          }
+        }
+      }
+    }
+  }
+
+  // join the remaining components, each by its shortest way out per pass, until one is left
+  struct Way
+  {
+    double distance;
+    uint32_t from;
+    uint32_t to;
+  };
+  int64_t maxRing = static_cast<int64_t>(side / radius) + 1;
+  while (true) {
+    // the largest component is left to the others, its members would search the longest
+    std::map<uint32_t, uint32_t> sizes;
+    for (uint32_t i = 0; i < n; ++i) {
+      sizes[findRoot(parents, i)]++;
+    }
+    if (sizes.size() < 2) {
+      break;
+    }
+    uint32_t largest = std::max_element(sizes.begin(), sizes.end(),
+                                        [] (const std::pair<const uint32_t, uint32_t>& a,
+                                            const std::pair<const uint32_t, uint32_t>& b) {
+                                          return a.second < b.second;
+                                        })->first;
+
+    std::map<uint32_t, Way> ways; // by component
+    for (uint32_t i = 0; i < n; ++i) {
+      uint32_t component = findRoot(parents, i);
+      if (component == largest) {
+        continue;
+      }
+      Way& way = ways.emplace(component, Way{std::numeric_limits<double>::max(), i, i}).first->second;
+
+      // rings of buckets around i, ring r is at least (r - 1) * radius away
+      int64_t cx = static_cast<int64_t>(m_positions[i].x / radius);
+      int64_t cy = static_cast<int64_t>(m_positions[i].y / radius);
+      for (int64_t r = 0; r <= maxRing && (r == 0 || (r - 1) * radius < way.distance); ++r) {
+        for (int64_t dx = -r; dx <= r; ++dx) {
+          int64_t step = (dx == -r || dx == r) ? 1 : 2 * r;
+          for (int64_t dy = -r; dy <= r; dy += step) {
+            auto it = cells.find(Cell(cx + dx, cy + dy));
+            if (it == cells.end()) {
+              continue;
+            }
+            for (uint32_t j : it->second) {
+              double distance = CalculateDistance(m_positions[i], m_positions[j]);
+              if (distance < way.distance && findRoot(parents, j) != component) {
+                way = Way{distance, i, j};
+              }
+            }
+          }
+        }
+      }
+    }
+
+    // components whose ways lead to each other are joined once
+    for (const auto& way : ways) {
+      uint32_t from = findRoot(parents, way.second.from);
+      uint32_t to = findRoot(parents, way.second.to);
+      if (from != to) {
+        AddLink(way.second.from, way.second.to);
+        parents[from] = to;
+      }
+    }
+  }
+
+  std::vector<uint32_t> candidates(n - (n > 1 ? 1 : 0));
+  std::iota(candidates.begin(), candidates.end(), n > 1 ? 1 : 0);
+  SelectAccessRouters(candidates);
+}
+
+void
+KiteTopologyBuilder::SelectAccessRouters(std::vector<uint32_t> candidates)
+{
+  uint32_t nAccess = static_cast<uint32_t>(std::ceil(candidates.size() * m_accessDensity));
+  nAccess = std::max<uint32_t>(std::min<uint32_t>(nAccess, candidates.size()), 1);
+
+  // partial Fisher-Yates, drawn from the ns-3 RNG so runs are reproducible
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable>();
+  for (uint32_t i = 0; i < nAccess && i + 1 < candidates.size(); ++i) {
+    uint32_t j = random->GetInteger(i, candidates.size() - 1);
+    std::swap(candidates[i], candidates[j]);
+  }
+  candidates.resize(nAccess);
+  std::sort(candidates.begin(), candidates.end());
+
+  m_accessIndices = candidates;
+}
+
+std::vector<double>
+KiteTopologyBuilder::GetIslandBounds(uint32_t systemId) const
+{
+  std::vector<double> bounds;
+  for (uint32_t i : m_accessIndices) {
+    if (m_systemIds[i] != systemId) {
+      continue;
+    }
+    const Vector& position = m_positions[i];
+    if (bounds.empty()) {
+      bounds = {position.x, position.x, position.y, position.y};
+    }
+    bounds[0] = std::min(bounds[0], position.x);
+    bounds[1] = std::max(bounds[1], position.x);
+    bounds[2] = std::min(bounds[2], position.y);
+    bounds[3] = std::max(bounds[3], position.y);
+  }
+  return bounds;
+}
+
+std::vector<double>
+KiteTopologyBuilder::GetBounds() const
+{
+  std::vector<double> bounds = {m_positions[0].x, m_positions[0].x, m_positions[0].y, m_positions[0].y};
+  for (const Vector& position : m_positions) {
+    bounds[0] = std::min(bounds[0], position.x);
+    bounds[1] = std::max(bounds[1], position.x);
+    bounds[2] = std::min(bounds[2], position.y);
+    bounds[3] = std::max(bounds[3], position.y);
+  }
+  return bounds;
+}
+
+void
+KiteTopologyBuilder::InstallStrategy(bool isKite) const
+{
+  if (isKite) {
+    StrategyChoiceHelper::Install<::nfd::fw::TraceForwardingStrategy>(m_routers, "/");
+  }
+  else {
+    StrategyChoiceHelper::Install(m_routers, "/", "/localhost/nfd/strategy/multicast");
+  }
+}
+
+std::vector<int64_t>
+KiteTopologyBuilder::GetShortestPathTree() const
+{
+  // Dijkstra from router 0, the one next to the server
+  uint32_t n = m_positions.size();
+  std::vector<int64_t> parents(n, -1);
+  std::vector<uint64_t> distances(n, std::numeric_limits<uint64_t>::max());
+  typedef std::pair<uint64_t, uint32_t> QueueEntry; // distance, router
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+  parents[0] = 0;
+  distances[0] = 0;
+  queue.emplace(0, 0);
+  while (!queue.empty()) {
+    QueueEntry entry = queue.top();
+    queue.pop();
+    uint32_t i = entry.second;
+    if (entry.first > distances[i]) {
+      continue; // stale entry
+    }
+    for (uint32_t linkIndex : m_adjacency[i]) {
+      const Link& link = m_links[linkIndex];
+      uint32_t j = link.a == i ? link.b : link.a;
+      if (distances[i] + link.metric < distances[j]) {
+        distances[j] = distances[i] + link.metric;
+        parents[j] = i;
+        queue.emplace(distances[j], j);
+      }
+    }
+  }
+  return parents;
+}
+
+void
+KiteTopologyBuilder::Partition()
+{
+  uint32_t n = m_positions.size();
+  m_systemIds.assign(n, 0);
+  if (m_nSystems <= 1) {
+    return;
+  }
+
+  std::vector<int64_t> parents = GetShortestPathTree();
+  std::vector<std::vector<uint32_t>> children(n);
+  for (uint32_t i = 1; i < n; ++i) {
+    if (parents[i] != -1) {
+      children[parents[i]].push_back(i);
+    }
+  }
+
+  // subtree sizes, children after their parents in order
+  std::vector<uint32_t> order(1, 0);
+  for (uint32_t k = 0; k < order.size(); ++k) {
+    order.insert(order.end(), children[order[k]].begin(), children[order[k]].end());
+  }
+  std::vector<uint32_t> sizes(n, 1);
+  for (auto i = order.rbegin(); i != order.rend() && *i != 0; ++i) {
+    sizes[parents[*i]] += sizes[*i];
+  }
+
+  // split the largest subtree until all fit in half a rank, its root stays on rank 0. On a path-like
+  // tree splits only move routers into that trunk, so it is capped at one rank
+  auto isSmaller = [&sizes] (uint32_t a, uint32_t b) { return sizes[a] < sizes[b]; };
+  std::vector<uint32_t> subtrees = children[0];
+  std::make_heap(subtrees.begin(), subtrees.end(), isSmaller);
+  uint32_t nTrunk = 1;
+  uint32_t maxTrunk = std::max(n / m_nSystems, 1u);
+  while (!subtrees.empty() && !children[subtrees.front()].empty() && nTrunk < maxTrunk
+         && (subtrees.size() < 2 * m_nSystems || sizes[subtrees.front()] > n / (2 * m_nSystems))) {
+    std::pop_heap(subtrees.begin(), subtrees.end(), isSmaller);
+    uint32_t root = subtrees.back();
+    subtrees.pop_back();
+    nTrunk++;
+    for (uint32_t child : children[root]) {
+      subtrees.push_back(child);
+      std::push_heap(subtrees.begin(), subtrees.end(), isSmaller);
+    }
+  }
+
+  // largest first onto the least loaded rank
+  std::sort(subtrees.begin(), subtrees.end(), [&sizes] (uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+  std::vector<uint32_t> loads(m_nSystems, 0);
+  loads[0] = nTrunk;
+  for (uint32_t root : subtrees) {
+    uint32_t systemId = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    loads[systemId] += sizes[root];
+    std::vector<uint32_t> stack(1, root);
+    while (!stack.empty()) {
+      uint32_t i = stack.back();
+      stack.pop_back();
+      m_systemIds[i] = systemId;
+      stack.insert(stack.end(), children[i].begin(), children[i].end());
+    }
+  }
+
+  uint32_t maxLoad = *std::max_element(loads.begin(), loads.end());
+  if (maxLoad > 2 * ((n - 1) / m_nSystems + 1)) {
+    NS_LOG_WARN("The shortest path tree has too few branches to balance " << n << " routers over "
+                << m_nSystems << " ranks, one of them gets " << maxLoad);
+  }
+
+  uint32_t nCut = std::count_if(m_links.begin(), m_links.end(),
+                                [this] (const Link& link) { return m_systemIds[link.a] != m_systemIds[link.b]; });
+  NS_LOG_INFO("Split " << n << " routers over " << m_nSystems << " ranks, from " << *std::min_element(loads.begin(), loads.end())
+              << " to " << maxLoad << " routers each, " << nCut << " links between ranks");
+}
+
+void
+KiteTopologyBuilder::InstallRoutes(const Name& serverPrefix, const Name& mobilePrefix, bool isKite) const
+{
+  uint32_t n = m_routers.GetN();
+  std::vector<int64_t> parents = GetShortestPathTree();
+
+  // the server has no default routes, its tracing Interests leave through router 0
+  FibHelper::AddRoute(m_server, mobilePrefix, m_routers.Get(0), 1);
+  FibHelper::AddRoute(m_routers.Get(0), serverPrefix, m_server, 1);
+  for (uint32_t i = 1; i < n; ++i) {
+    if (parents[i] == -1) {
+      NS_LOG_WARN("Router " << i << " cannot reach the server");
+      continue;
+    }
+    FibHelper::AddRoute(m_routers.Get(i), serverPrefix, m_routers.Get(parents[i]), 1);
+    if (!isKite) {
+      FibHelper::AddRoute(m_routers.Get(parents[i]), mobilePrefix, m_routers.Get(i), 1);
+    }
+  }
+
+  if (!isKite) {
+    for (uint32_t i = 0; i < m_accessRouters.GetN(); ++i) {
+      Ptr<L3Protocol> l3 = m_accessRouters.Get(i)->GetObject<L3Protocol>();
+      for (const auto& face : l3->getForwarder()->getFaceTable()) {
+        if (face.getLinkType() == ::ndn::nfd::LINK_TYPE_MULTI_ACCESS) {
+          FibHelper::AddRoute(m_accessRouters.Get(i), mobilePrefix, l3->getFaceById(face.getId()), 1);
+        }
+      }
+    }
+  }
+}
+
+NodeContainer
+KiteTopologyBuilder::CreateMobiles(uint32_t count) const
+{
+  NodeContainer mobiles;
+  for (uint32_t i = 0; i < count; ++i) {
+    mobiles.Add(CreateObject<Node>(m_systemIds[m_accessIndices[i % m_accessIndices.size()]]));
+  }
+  return mobiles;
+}
+
+void
+KiteTopologyBuilder::InstallMobility(const NodeContainer& mobiles, double speed) const
+{
+  // mobiles by rank, the one of the access router they start at
+  std::map<uint32_t, std::pair<NodeContainer, Ptr<ListPositionAllocator>>> islands;
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable>();
+  for (uint32_t i = 0; i < mobiles.GetN(); ++i) {
+    uint32_t accessIndex = m_accessIndices[i % m_accessIndices.size()];
+    Vector position = m_positions[accessIndex];
+    // walk bounds are the router bounds plus half a spacing, so the start is always inside
+    position.x += random->GetValue(-m_spacing / 2, m_spacing / 2);
+    position.y += random->GetValue(-m_spacing / 2, m_spacing / 2);
+
+    auto& island = islands[m_systemIds[accessIndex]];
+    if (island.second == nullptr) {
+      island.second = CreateObject<ListPositionAllocator>();
+    }
+    island.first.Add(mobiles.Get(i));
+    island.second->Add(position);
+  }
+
+  std::stringstream ss;
+  ss << "ns3::UniformRandomVariable[Min=" << speed << "|Max=" << speed << "]";
+
+  for (const auto& island : islands) {
+    std::vector<double> bounds = m_nSystems > 1 ? GetIslandBounds(island.first) : GetBounds();
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator(island.second.second);
+    mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+                              "Bounds", RectangleValue(Rectangle(bounds[0] - m_spacing / 2, bounds[1] + m_spacing / 2,
+                                                                 bounds[2] - m_spacing / 2, bounds[3] + m_spacing / 2)),
+                              "Distance", DoubleValue(m_spacing),
+                              "Speed", StringValue(ss.str()));
+    mobility.Install(island.second.first);
+  }
+}
+
+} // namespace ndn
+} // namespace ns3
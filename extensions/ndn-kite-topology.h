@@ -0,0 +1,265 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_TOPOLOGY_H
+#define NDN_KITE_TOPOLOGY_H
+
+#include "ns3/ndnSIM/model/ndn-common.hpp"
+
+#include "ns3/node-container.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Builds the stationary part of upload scenarios: a router backbone with a server and access routers
+ *
+ * The backbone is one of
+ *  - "grid": a square grid of routers, Spacing meters apart;
+ *  - "tree": a complete tree of the given degree, rooted at router 0;
+ *  - "rgg": a random geometric graph, routers uniform in a square of side sqrt(n) * Spacing
+ *    and linked when closer than Radius, plus the shortest links that make it connected;
+ *  - a file, see Load().
+ *
+ * The server hangs off router 0. A fraction of the routers (the leaves, for trees) are access routers,
+ * the ones mobiles attach to. Routers get constant positions so that wireless access works.
+ *
+ * For distributed runs, SetSystemCount() splits the backbone over MPI ranks by subtrees. Each rank then
+ * holds a wireless island: its access routers, and the mobiles of CreateMobiles() that start and walk there.
+ *
+ * Usage:
+ *
+ *     ndn::KiteTopologyBuilder topology;
+ *     topology.SetTopology("grid");
+ *     topology.SetRouterCount(1000);
+ *     topology.Build(p2p);
+ *     wifi.Install(wifiPhy, wifiMac, topology.GetAccessRouters());
+ *     ndnHelper.InstallAll();
+ *     topology.InstallStrategy(true);
+ *     topology.InstallRoutes("/server", "/mobile", true);
+ */
+class KiteTopologyBuilder {
+public:
+  KiteTopologyBuilder();
+
+  /**
+   * @param type "grid", "tree" or "rgg"
+   */
+  void
+  SetTopology(const std::string& type);
+
+  /**
+   * @brief Number of routers, rounded up to a square for grids
+   */
+  void
+  SetRouterCount(uint32_t nRouters);
+
+  void
+  SetTreeDegree(uint32_t degree);
+
+  /**
+   * @brief Distance between neighbouring routers in meters
+   */
+  void
+  SetSpacing(double spacing);
+
+  /**
+   * @brief Link radius of random geometric graphs, in meters (default 1.5 * Spacing)
+   */
+  void
+  SetRadius(double radius);
+
+  /**
+   * @brief Fraction of the routers that serve mobiles
+   */
+  void
+  SetAccessDensity(double density);
+
+  /**
+   * @brief Number of MPI ranks (systems) to split the backbone over, 1 by default
+   *
+   * Ranks get whole subtrees of the shortest path tree rooted at router 0, balanced by router count.
+   * Router 0, the server and the routers above split subtrees stay on rank 0, at most one rank's share of
+   * them. A tree with too few branches (a chain, say) cannot be balanced, which is logged as a warning.
+   * Only point-to-point links cross ranks, and they must have a delay, which is the lookahead of the
+   * distributed simulator.
+   */
+  void
+  SetSystemCount(uint32_t count);
+
+  /**
+   * @brief Loads the backbone from a file instead of generating it
+   *
+   * Two formats are recognized:
+   *  - ndnSIM's annotated topology format. The "router" section has "name comment yPos xPos" lines and the
+   *    "link" section has "src dst capacity metric delay [maxPackets]" lines. Routers commented "access" are
+   *    the access routers. If none is, they are drawn with AccessDensity;
+   *  - the binary format written by Save(), recognized by its magic number. It needs no parsing, so use it for
+   *    maps of many thousand routers.
+   *
+   * The first router listed is the one next to the server.
+   */
+  void
+  Load(const std::string& filename);
+
+  /**
+   * @brief Saves the backbone in the binary format, e.g. to convert an annotated topology once
+   * @pre the backbone is built or loaded
+   */
+  void
+  Save(const std::string& filename) const;
+
+  /**
+   * @brief Creates the server and the routers, and links them with @p p2p
+   *
+   * Links loaded with a rate, delay or queue size get them set on their devices,
+   * the others keep the defaults of @p p2p.
+   */
+  void
+  Build(PointToPointHelper& p2p);
+
+  Ptr<Node>
+  GetServer() const
+  {
+    return m_server;
+  }
+
+  const NodeContainer&
+  GetRouters() const
+  {
+    return m_routers;
+  }
+
+  const NodeContainer&
+  GetAccessRouters() const
+  {
+    return m_accessRouters;
+  }
+
+  /**
+   * @brief Smallest rectangle holding all routers, as {xMin, xMax, yMin, yMax}
+   */
+  std::vector<double>
+  GetBounds() const;
+
+  /**
+   * @brief Creates @p count mobiles, each on the rank of the access router InstallMobility() starts it at
+   */
+  NodeContainer
+  CreateMobiles(uint32_t count) const;
+
+  /**
+   * @brief Installs TraceForwardingStrategy on all routers, or multicast as a non-Kite baseline
+   * @pre the NDN stack is installed
+   */
+  void
+  InstallStrategy(bool isKite) const;
+
+  /**
+   * @brief Routes @p serverPrefix towards the server along the shortest path tree rooted at it, by link metric
+   *
+   * The server itself routes @p mobilePrefix to router 0, so that its tracing Interests enter the backbone.
+   * Without Kite, @p mobilePrefix is also routed down the same shortest path tree and out of every
+   * multi-access face of the access routers, so that the multicast baseline floods tracing Interests
+   * to the mobiles.
+   * @pre the NDN stack is installed
+   */
+  void
+  InstallRoutes(const Name& serverPrefix, const Name& mobilePrefix, bool isKite) const;
+
+  /**
+   * @brief Places mobiles around the access routers, round-robin, and lets them walk the whole area
+   *
+   * With several ranks, a mobile only walks the bounding box of the access routers of its rank, since a
+   * wireless island cannot hand mobiles over to another rank. This deliberately differs from a single
+   * rank run: mobiles no longer cross rank borders, and where the box of a rank covers cells served by
+   * another rank, its mobiles meet no access router there and stay detached until they walk out.
+   */
+  void
+  InstallMobility(const NodeContainer& mobiles, double speed) const;
+
+private:
+  void
+  BuildGrid();
+
+  void
+  BuildTree();
+
+  void
+  BuildRandomGeometric();
+
+  void
+  SelectAccessRouters(std::vector<uint32_t> candidates);
+
+  /**
+   * @brief Parent of each router on the shortest path towards router 0 by link metric, -1 if unreachable
+   */
+  std::vector<int64_t>
+  GetShortestPathTree() const;
+
+  /**
+   * @brief Assigns each router to a rank
+   */
+  void
+  Partition();
+
+  /**
+   * @brief Smallest rectangle holding the access routers of rank @p systemId
+   */
+  std::vector<double>
+  GetIslandBounds(uint32_t systemId) const;
+
+  void
+  LoadAnnotated(std::istream& is);
+
+  void
+  LoadBinary(std::istream& is);
+
+  void
+  AddLink(uint32_t a, uint32_t b, uint32_t metric = 1, uint64_t rate = 0, Time delay = Time(), uint32_t maxPackets = 0);
+
+private:
+  struct Link
+  {
+    uint32_t a;
+    uint32_t b;
+    uint32_t metric;
+    uint64_t rate;       // bit/s, 0 for the default of the helper
+    Time delay;          // 0 for the default of the helper
+    uint32_t maxPackets; // 0 for the default of the helper
+  };
+
+  std::string m_type;
+  uint32_t m_nRouters;
+  uint32_t m_treeDegree;
+  double m_spacing;
+  double m_radius; // 0 for 1.5 * m_spacing
+  double m_accessDensity;
+  uint32_t m_nSystems;
+
+  Ptr<Node> m_server;
+  NodeContainer m_routers;
+  NodeContainer m_accessRouters;
+
+  std::vector<Vector> m_positions;                 // by router index
+  std::vector<std::vector<uint32_t>> m_adjacency;  // link indices by router index
+  std::vector<Link> m_links;
+  std::vector<uint32_t> m_accessIndices;
+  std::vector<uint32_t> m_systemIds;               // by router index
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_TOPOLOGY_H
@@ -26,12 +26,23 @@
 #include "ns3/double.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
+#include "ns3/pointer.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
 
 #include "model/ndn-l3-protocol.hpp"
 #include "helper/ndn-fib-helper.hpp"
+#include "helper/ndn-stack-helper.hpp"
+
+#include "ndn-kite-request-signer.h"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
 
 #include <memory>
 #include <ctime>
+#include <functional>
+#include <algorithm>
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteUploadMobile");
 
@@ -64,6 +75,47 @@ KiteUploadMobile::GetTypeId(void)
       .AddAttribute("SendFrequency", "Interval between every two interests", StringValue("3s"),
                     MakeTimeAccessor(&KiteUploadMobile::m_sendFrequency), MakeTimeChecker())
 
+      .AddAttribute("StartJitter", "The first trace is sent at a uniformly random time within this after start",
+                    StringValue("0s"),
+                    MakeTimeAccessor(&KiteUploadMobile::m_startJitter), MakeTimeChecker())
+
+      .AddAttribute("TraceOnMove", "Send traces on attachment changes plus a keepalive, instead of periodically",
+                    BooleanValue(false),
+                    MakeBooleanAccessor(&KiteUploadMobile::m_traceOnMove), MakeBooleanChecker())
+      .AddAttribute("CellSize", "Side of the square cells whose crossing triggers a trace, 0 to disable",
+                    DoubleValue(0),
+                    MakeDoubleAccessor(&KiteUploadMobile::m_cellSize), MakeDoubleChecker<double>(0))
+      .AddAttribute("KeepaliveInterval",
+                    "Interval between traces of a mobile that does not move, shorter than TraceLifeTime",
+                    StringValue("8s"),
+                    MakeTimeAccessor(&KiteUploadMobile::m_keepaliveInterval), MakeTimeChecker())
+      .AddAttribute("MinTraceInterval", "Traces triggered closer than this are coalesced", StringValue("100ms"),
+                    MakeTimeAccessor(&KiteUploadMobile::m_minTraceInterval), MakeTimeChecker())
+
+      .AddAttribute("FecK", "Source segments per erasure-coded group, 0 to upload plain segments",
+                    UintegerValue(0),
+                    MakeUintegerAccessor(&KiteUploadMobile::m_fecK), MakeUintegerChecker<uint32_t>())
+      .AddAttribute("FecN", "Coded segments per group, at most 256", UintegerValue(0),
+                    MakeUintegerAccessor(&KiteUploadMobile::m_fecN), MakeUintegerChecker<uint32_t>(0, 256))
+
+      .AddAttribute("SignRequests", "Sign upload requests so the server can verify them", BooleanValue(false),
+                    MakeBooleanAccessor(&KiteUploadMobile::m_signRequests), MakeBooleanChecker())
+      .AddAttribute("KeyEpoch", "Lifetime of a signing key", StringValue("60s"),
+                    MakeTimeAccessor(&KiteUploadMobile::m_keyEpoch), MakeTimeChecker())
+
+      .AddAttribute("ObjectSize",
+                    "Bytes to upload, 0 for the whole PayloadFile or, without one, to answer every "
+                    "tracing Interest with virtual payload",
+                    UintegerValue(0),
+                    MakeUintegerAccessor(&KiteUploadMobile::m_objectSize), MakeUintegerChecker<uint64_t>())
+      .AddAttribute("PayloadFile", "File whose bytes are uploaded, generated content if empty", StringValue(""),
+                    MakeStringAccessor(&KiteUploadMobile::m_payloadFile), MakeStringChecker())
+      .AddAttribute("MaxCachedSegments",
+                    "Upper bound of the prebuilt Data packet cache, 0 for the whole object "
+                    "(64 segments if it is unbounded)",
+                    UintegerValue(0),
+                    MakeUintegerAccessor(&KiteUploadMobile::m_maxCachedSegments), MakeUintegerChecker<uint32_t>())
+
     ;
   return tid;
 }
@@ -73,12 +125,177 @@ KiteUploadMobile::OnInterest(shared_ptr<const Interest> interest)
 {
   NS_LOG_INFO("\nMOBILE: Receive tracing Interest: " << interest->getName());
 
-  //Producer::OnInterest(interest);
+  const Name& name = interest->getName();
+  if (m_payload == nullptr || name.size() != m_mobilePrefix.size() + 1
+      || !m_mobilePrefix.isPrefixOf(name) || !name[-1].isSequenceNumber()) {
+    Producer::OnInterest(interest);
+    return;
+  }
+
+  App::OnInterest(interest); // tracing inside
+  if (!m_active)
+    return;
+
+  shared_ptr<const Data> data = GetSegment(name[-1].toSequenceNumber());
+  if (data == nullptr) {
+    NS_LOG_INFO("MOBILE: No such segment: " << name);
+    return;
+  }
+
+  m_nServedBytes += data->wireEncode().size();
+
+  m_transmittedDatas(data, this, m_face);
+  m_appLink->onReceiveData(*data);
+}
+
+uint32_t
+KiteUploadMobile::GetSegmentCount() const
+{
+  if (m_objectSize == 0 || m_segmentSize == 0) {
+    return 0;
+  }
+  uint64_t nSegments = (m_objectSize - 1) / m_segmentSize + 1;
+  return static_cast<uint32_t>(std::min<uint64_t>(nSegments, std::numeric_limits<uint32_t>::max()));
+}
+
+shared_ptr<const Data>
+KiteUploadMobile::GetSegment(uint32_t seq)
+{
+  auto it = m_segments.find(seq);
+  if (it != m_segments.end()) {
+    m_nCacheHits++;
+    m_segmentOrder.splice(m_segmentOrder.end(), m_segmentOrder, it->second.second);
+    return it->second.first;
+  }
+
+  shared_ptr<const Data> data = MakeSegment(seq);
+  if (data == nullptr) {
+    return nullptr;
+  }
+
+  m_nCacheMisses++;
+  CacheSegment(seq, data);
+  return data;
+}
+
+void
+KiteUploadMobile::CacheSegment(uint32_t seq, shared_ptr<const Data> data)
+{
+  if (m_segmentCacheLimit == 0) {
+    return;
+  }
+  if (m_segments.size() >= m_segmentCacheLimit) {
+    m_segments.erase(m_segmentOrder.front());
+    m_segmentOrder.pop_front();
+  }
+  m_segments.emplace(seq, std::make_pair(data, m_segmentOrder.insert(m_segmentOrder.end(), seq)));
+}
+
+void
+KiteUploadMobile::BuildSegmentCache()
+{
+  m_segments.clear();
+  m_segmentOrder.clear();
+
+  uint32_t nSegments = GetSegmentCount();
+  m_segmentCacheLimit = m_maxCachedSegments;
+  if (m_segmentCacheLimit == 0) {
+    m_segmentCacheLimit = nSegments > 0 ? std::numeric_limits<uint32_t>::max() : 64;
+  }
+
+  // in the order the server pulls them: with FEC, the source segments of each group
+  uint32_t nPrebuilt = std::min(m_segmentCacheLimit, nSegments > 0 ? nSegments : m_segmentCacheLimit);
+  for (uint32_t i = 0; i < nPrebuilt; i++) {
+    uint32_t seq = (m_fec == nullptr) ? i : (i / m_fecK) * m_fecN + i % m_fecK;
+    shared_ptr<const Data> data = MakeSegment(seq);
+    if (data == nullptr) {
+      break;
+    }
+    CacheSegment(seq, data);
+  }
+
+  NS_LOG_INFO("MOBILE: " << m_mobilePrefix << " prebuilt " << m_segments.size() << " segments");
+}
+
+shared_ptr<const Data>
+KiteUploadMobile::MakeSegment(uint32_t seq) const
+{
+  KiteFecCoder::Symbol content;
+  if (m_fec != nullptr) {
+    uint32_t group = seq / m_fecN;
+    uint32_t nSegments = GetSegmentCount();
+    if (nSegments > 0 && group * m_fecK >= nSegments) {
+      return nullptr;
+    }
+
+    std::vector<KiteFecCoder::Symbol> source;
+    source.reserve(m_fecK);
+    for (uint32_t j = 0; j < m_fecK; j++) {
+      source.push_back(ReadSourceSymbol(group * m_fecK + j));
+    }
+    content = m_fec->Encode(source, seq % m_fecN);
+  }
+  else if (seq >= GetSegmentCount()) {
+    return nullptr;
+  }
+
+  auto data = make_shared<Data>();
+  data->setName(Name(m_mobilePrefix).appendSequenceNumber(seq));
+  data->setFreshnessPeriod(::ndn::time::milliseconds(m_segmentFreshness.GetMilliSeconds()));
+  if (m_fec != nullptr) {
+    data->setContent(content.data(), content.size());
+  }
+  else {
+    // one copy from the payload source into the content, the last segment carries the rest of the object
+    uint64_t offset = static_cast<uint64_t>(seq) * m_segmentSize;
+    size_t size = static_cast<size_t>(std::min<uint64_t>(m_segmentSize, m_objectSize - offset));
+    std::vector<uint8_t> scratch;
+    data->setContent(m_payload->GetSlice(offset, size, scratch), size);
+    data->setFinalBlockId(name::Component::fromSequenceNumber(GetSegmentCount() - 1));
+  }
+
+  // DigestSha256 needs no key to check, signing encodes the wire once and every copy sent shares it
+  StackHelper::getKeyChain().sign(*data, ::ndn::security::signingWithSha256());
+
+  return data;
+}
+
+KiteFecCoder::Symbol
+KiteUploadMobile::ReadSourceSymbol(uint32_t sourceSeq) const
+{
+  // symbols of a group have the same size, the end of the object is padded with zeros
+  KiteFecCoder::Symbol symbol(m_segmentSize, 0);
+  uint64_t offset = static_cast<uint64_t>(sourceSeq) * m_segmentSize;
+  if (offset < m_payload->GetSize()) {
+    size_t size = static_cast<size_t>(std::min<uint64_t>(m_segmentSize, m_payload->GetSize() - offset));
+    std::vector<uint8_t> scratch;
+    const uint8_t* slice = m_payload->GetSlice(offset, size, scratch);
+    std::copy(slice, slice + size, symbol.begin());
+  }
+  return symbol;
 }
 
 KiteUploadMobile::KiteUploadMobile()
   : m_rand(CreateObject<UniformRandomVariable>())
   , m_seq(0) 
+  , m_traceOnMove(false)
+  , m_cellSize(0)
+  , m_hasCell(false)
+  , m_cellX(0)
+  , m_cellY(0)
+  , m_isMoveTrace(false)
+  , m_nTraces(0)
+  , m_nMoveTraces(0)
+  , m_fecK(0)
+  , m_fecN(0)
+  , m_signRequests(false)
+  , m_objectSize(0)
+  , m_maxCachedSegments(0)
+  , m_segmentCacheLimit(0)
+  , m_segmentSize(1024)
+  , m_nCacheHits(0)
+  , m_nCacheMisses(0)
+  , m_nServedBytes(0)
 {
   NS_LOG_FUNCTION_NOARGS();
 }
@@ -89,8 +306,61 @@ KiteUploadMobile::StartApplication()
 {
   NS_LOG_FUNCTION_NOARGS();
   Producer::StartApplication();
-  
-  SendTrace();
+
+  if (m_fecK > 0) {
+    m_fec = make_shared<KiteFecCoder>(m_fecK, std::max(m_fecN, m_fecK));
+    m_fecN = m_fec->GetN();
+  }
+
+  if (m_fec != nullptr || m_objectSize > 0 || !m_payloadFile.empty()) {
+    // Producer keeps these private
+    UintegerValue payloadSize;
+    GetAttribute("PayloadSize", payloadSize);
+    m_segmentSize = payloadSize.Get();
+    TimeValue freshness;
+    GetAttribute("Freshness", freshness);
+    m_segmentFreshness = freshness.Get();
+
+    if (!m_payloadFile.empty()) {
+      m_payload = KitePayloadSource::CreateFromFile(m_payloadFile);
+      if (m_objectSize == 0 || m_objectSize > m_payload->GetSize()) {
+        m_objectSize = m_payload->GetSize();
+      }
+    }
+    else {
+      // an unbounded object with FEC and no ObjectSize
+      uint64_t size = m_objectSize > 0 ? m_objectSize : std::numeric_limits<uint64_t>::max();
+      m_payload = KitePayloadSource::CreateGenerator(size, std::hash<std::string>()(m_mobilePrefix.toUri()));
+    }
+
+    BuildSegmentCache();
+  }
+
+  if (m_traceOnMove) {
+    // an expired trace erases the Tt and Itt state, leaving a mobile that stays put unreachable
+    if (m_keepaliveInterval >= m_traceLifeTime) {
+      NS_FATAL_ERROR("KeepaliveInterval (" << m_keepaliveInterval.GetSeconds() << "s) must be shorter than "
+                     << "TraceLifeTime (" << m_traceLifeTime.GetSeconds() << "s)");
+    }
+
+    Ptr<MobilityModel> mobility = GetNode()->GetObject<MobilityModel>();
+    if (mobility != nullptr) {
+      mobility->TraceConnectWithoutContext("CourseChange", MakeCallback(&KiteUploadMobile::OnCourseChange, this));
+      CheckCell();
+    }
+
+    // station MACs report (re)associations, ad hoc ones have no such trace
+    for (uint32_t i = 0; i < GetNode()->GetNDevices(); i++) {
+      PointerValue mac;
+      if (GetNode()->GetDevice(i)->GetAttributeFailSafe("Mac", mac) && mac.Get<Object>() != nullptr) {
+        mac.Get<Object>()->TraceConnectWithoutContext("Assoc", MakeCallback(&KiteUploadMobile::OnAssociation, this));
+      }
+    }
+  }
+
+  // mobiles started together would otherwise trace in lockstep
+  Time offset = Seconds(m_rand->GetValue(0, m_startJitter.GetSeconds()));
+  m_traceEvent = Simulator::Schedule(offset, &KiteUploadMobile::SendTrace, this);
 }
 
 void
@@ -98,9 +368,121 @@ KiteUploadMobile::StopApplication()
 {
   NS_LOG_FUNCTION_NOARGS();
 
+  Simulator::Cancel(m_traceEvent);
+  Simulator::Cancel(m_cellCheckEvent);
+  if (m_traceOnMove) {
+    Ptr<MobilityModel> mobility = GetNode()->GetObject<MobilityModel>();
+    if (mobility != nullptr) {
+      mobility->TraceDisconnectWithoutContext("CourseChange", MakeCallback(&KiteUploadMobile::OnCourseChange, this));
+    }
+    for (uint32_t i = 0; i < GetNode()->GetNDevices(); i++) {
+      PointerValue mac;
+      if (GetNode()->GetDevice(i)->GetAttributeFailSafe("Mac", mac) && mac.Get<Object>() != nullptr) {
+        mac.Get<Object>()->TraceDisconnectWithoutContext("Assoc", MakeCallback(&KiteUploadMobile::OnAssociation, this));
+      }
+    }
+  }
+
   App::StopApplication();
 }
 
+void
+KiteUploadMobile::NotifyAttachmentChange()
+{
+  if (!m_active)
+    return;
+
+  NS_LOG_INFO("MOBILE: " << m_mobilePrefix << " attachment changed");
+  TriggerTrace();
+}
+
+int64_t
+KiteUploadMobile::AssignStreams(int64_t stream)
+{
+  m_rand->SetStream(stream);
+  if (m_random == 0) {
+    return 1;
+  }
+  m_random->SetStream(stream + 1);
+  return 2;
+}
+
+void
+KiteUploadMobile::TriggerTrace()
+{
+  m_isMoveTrace = true;
+
+  Time earliest = m_lastTraceTime + m_minTraceInterval;
+  if (m_nTraces > 0 && earliest > Simulator::Now()) {
+    // coalesce with a trace already due before then
+    if (m_traceEvent.IsRunning() && Simulator::GetDelayLeft(m_traceEvent) <= earliest - Simulator::Now()) {
+      return;
+    }
+    Simulator::Cancel(m_traceEvent);
+    m_traceEvent = Simulator::Schedule(earliest - Simulator::Now(), &KiteUploadMobile::SendTrace, this);
+    return;
+  }
+
+  Simulator::Cancel(m_traceEvent);
+  m_traceEvent = Simulator::ScheduleNow(&KiteUploadMobile::SendTrace, this);
+}
+
+void
+KiteUploadMobile::OnCourseChange(Ptr<const MobilityModel> mobility)
+{
+  CheckCell();
+}
+
+void
+KiteUploadMobile::OnAssociation(Mac48Address bssid)
+{
+  NS_LOG_INFO("MOBILE: " << m_mobilePrefix << " associated with " << bssid);
+  NotifyAttachmentChange();
+}
+
+void
+KiteUploadMobile::CheckCell()
+{
+  Simulator::Cancel(m_cellCheckEvent);
+  if (m_cellSize <= 0) {
+    return;
+  }
+
+  Ptr<MobilityModel> mobility = GetNode()->GetObject<MobilityModel>();
+  Vector position = mobility->GetPosition();
+  int64_t cellX = static_cast<int64_t>(std::floor(position.x / m_cellSize));
+  int64_t cellY = static_cast<int64_t>(std::floor(position.y / m_cellSize));
+
+  if (m_hasCell && (cellX != m_cellX || cellY != m_cellY)) {
+    NS_LOG_INFO("MOBILE: " << m_mobilePrefix << " entered cell (" << cellX << ", " << cellY << ")");
+    NotifyAttachmentChange();
+  }
+  m_hasCell = true;
+  m_cellX = cellX;
+  m_cellY = cellY;
+
+  // CourseChange only fires when the velocity changes, find out when the current course leaves the cell
+  Vector velocity = mobility->GetVelocity();
+  double delay = std::numeric_limits<double>::infinity();
+  if (velocity.x > 0) {
+    delay = std::min(delay, ((cellX + 1) * m_cellSize - position.x) / velocity.x);
+  }
+  else if (velocity.x < 0) {
+    delay = std::min(delay, (cellX * m_cellSize - position.x) / velocity.x);
+  }
+  if (velocity.y > 0) {
+    delay = std::min(delay, ((cellY + 1) * m_cellSize - position.y) / velocity.y);
+  }
+  else if (velocity.y < 0) {
+    delay = std::min(delay, (cellY * m_cellSize - position.y) / velocity.y);
+  }
+
+  if (delay != std::numeric_limits<double>::infinity()) {
+    // land just past the boundary
+    m_cellCheckEvent = Simulator::Schedule(Seconds(delay) + MicroSeconds(1), &KiteUploadMobile::CheckCell, this);
+  }
+}
+
 void
 KiteUploadMobile::SendTrace()
 {
@@ -108,6 +490,7 @@ KiteUploadMobile::SendTrace()
   NS_LOG_FUNCTION_NOARGS();
 
   shared_ptr<Name> name = make_shared<Name>(m_serverPrefix); // consumer is actually a stationary server under upload scenario
+  name->append(m_mobilePrefix); // one upload request name per mobile, so that requests of different mobiles are not aggregated
   Name traceName(m_mobilePrefix);
 
   //NS_LOG_INFO("m_mobilePrefix is: " << m_mobilePrefix);
@@ -121,16 +504,41 @@ KiteUploadMobile::SendTrace()
   shared_ptr<Interest> interest = make_shared<Interest>();
   interest->setNonce(m_rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
   interest->setName(*name);
-  //interest->setTraceName(traceName);
+  interest->setTraceName(traceName); // tells the server which mobile to pull from
   interest->setTraceFlag(1);
   time::milliseconds interestLifeTime(m_traceLifeTime.GetMilliSeconds());
   interest->setInterestLifetime(interestLifeTime);
 
+  if (m_signRequests) {
+    uint64_t epoch = 0;
+    if (m_keyEpoch.IsStrictlyPositive()) {
+      epoch = Simulator::Now().GetNanoSeconds() / m_keyEpoch.GetNanoSeconds();
+    }
+    KiteRequestSigner::Sign(*interest, KiteRequestSigner::GetKeyName(m_mobilePrefix, epoch));
+  }
+
   NS_LOG_INFO("\n########\n> Send trace Interest named " << *interest);
 
   //NS_LOG_INFO("TraceLifeTime: " << m_traceLifeTime);
 
-  Simulator::Schedule(Seconds(m_sendFrequency.GetSeconds()), &KiteUploadMobile::SendTrace, this); // Send out trace at intervals equal to lifetime of trace
+  m_nTraces++;
+  if (m_isMoveTrace) {
+    m_nMoveTraces++;
+    m_isMoveTrace = false;
+  }
+  m_lastTraceTime = Simulator::Now();
+
+  // a moving mobile sends traces when it moves, the timer is only a keepalive then
+  Time interval = m_traceOnMove ? m_keepaliveInterval : m_sendFrequency;
+  if (m_random != 0) {
+    interval = Seconds(interval.GetSeconds() * m_random->GetValue());
+  }
+  if (m_traceOnMove) {
+    // the trace must be renewed before it expires, randomization only brings the keepalive forward
+    interval = std::min(interval, m_keepaliveInterval);
+  }
+  Simulator::Cancel(m_traceEvent);
+  m_traceEvent = Simulator::Schedule(interval, &KiteUploadMobile::SendTrace, this); // Send out trace at intervals equal to lifetime of trace
 
   m_transmittedInterests(interest, this, m_face);
   m_appLink->onReceiveInterest(*interest);
@@ -139,20 +547,19 @@ KiteUploadMobile::SendTrace()
 void
 KiteUploadMobile::SetRandomize(const std::string& value)
 {
-  // if (value == "uniform") {
-  //   m_random = CreateObject<UniformRandomVariable>();
-  //   m_random->SetAttribute("Min", DoubleValue(0.0));
-  //   m_random->SetAttribute("Max", DoubleValue(2 * 1.0 / m_frequency));
-  // }
-  // else if (value == "exponential") {
-  //   m_random = CreateObject<ExponentialRandomVariable>();
-  //   m_random->SetAttribute("Mean", DoubleValue(1.0 / m_frequency));
-  //   m_random->SetAttribute("Bound", DoubleValue(50 * 1.0 / m_frequency));
-  // }
-  // else
-  //   m_random = 0;
-  
-  m_random = 0;
+  // in units of the trace interval, which may not be set yet
+  if (value == "uniform") {
+    m_random = CreateObject<UniformRandomVariable>();
+    m_random->SetAttribute("Min", DoubleValue(0.0));
+    m_random->SetAttribute("Max", DoubleValue(2.0));
+  }
+  else if (value == "exponential") {
+    m_random = CreateObject<ExponentialRandomVariable>();
+    m_random->SetAttribute("Mean", DoubleValue(1.0));
+    m_random->SetAttribute("Bound", DoubleValue(50.0));
+  }
+  else
+    m_random = 0;
 
   m_randomType = value;
 }
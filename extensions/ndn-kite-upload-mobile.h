@@ -25,9 +25,18 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/nstime.h"
 #include "ns3/ptr.h"
+#include "ns3/event-id.h"
+#include "ns3/mac48-address.h"
+#include "ns3/mobility-model.h"
 
 #include "ns3/ndnSIM/apps/ndn-producer.hpp"
 
+#include "ndn-kite-fec.h"
+#include "ndn-kite-payload-source.h"
+
+#include <list>
+#include <unordered_map>
+
 namespace ns3 {
 namespace ndn {
 
@@ -39,6 +48,25 @@ namespace ndn {
  * It also sends out traces periodically to update it's location in the network.
  * In upload scenario, this should run on a mobile node, 
  * and the trace is actually Interest packet aimed at a stationary server to which data is uploaded.
+ * With FecK set, the uploaded object is cut into groups of FecK source segments, and segment <seq>
+ * carries coded symbol seq % FecN of group seq / FecN, so the server can rebuild a group from any FecK of them.
+ * With ObjectSize or PayloadFile set, the mobile uploads an object of that many bytes, segment <seq>
+ * being <MobilePrefix>/<seq>. The bytes are read from the memory-mapped PayloadFile or generated on demand.
+ * Building a segment copies its slice once into the Data packet, since ndn-cxx Blocks own their buffers.
+ * Segments are encoded and signed (DigestSha256) once: the source segments of the object are built at start,
+ * and every tracing Interest is answered with the shared, already encoded Data packet. Coded segments pulled
+ * to repair a group are built on their first request and kept too. The cache thus holds the object, about
+ * ObjectSize bytes per mobile (times FecN / FecK with all repairs); MaxCachedSegments bounds it, dropping the
+ * least recently pulled segment first. An unbounded object keeps its 64 latest segments by default.
+ * With Randomize, the interval between traces is drawn uniformly from [0, 2 * SendFrequency] or exponentially
+ * with mean SendFrequency, and StartJitter spreads the first traces of mobiles started together.
+ * With TraceOnMove, traces follow attachment changes instead of the SendFrequency timer: a trace is sent
+ * when the mobile (re)associates on a wifi device, when it crosses into another CellSize x CellSize cell
+ * as reported by its mobility model, or when NotifyAttachmentChange() is called, and otherwise only every
+ * KeepaliveInterval. The keepalive must be shorter than TraceLifeTime, so that the trace of a mobile that
+ * stays put is renewed before routers drop it; Randomize only shortens it. Traces closer than MinTraceInterval
+ * are coalesced.
+ * With SignRequests, every upload request is signed (see KiteRequestSigner) with a key that changes every KeyEpoch.
  */
 class KiteUploadMobile : public Producer {
 public:
@@ -49,9 +77,56 @@ public:
 
   void SendTrace(); // Periodically send trace Interest packets(IFI)
 
+  /**
+   * @brief Tells the mobile it is now attached elsewhere, e.g., by scenarios that switch links by hand
+   */
+  void
+  NotifyAttachmentChange();
+
+  /**
+   * @brief Assigns fixed random variable streams to the nonces and the trace interval randomization
+   * @return number of streams used
+   */
+  int64_t
+  AssignStreams(int64_t stream);
+
   virtual void 
   OnInterest(shared_ptr<const Interest> interest);
 
+public: // statistics
+  uint64_t
+  GetTraceCount() const
+  {
+    return m_nTraces;
+  }
+
+  /**
+   * @brief Traces sent because the mobile moved, as opposed to keepalives
+   */
+  uint64_t
+  GetMoveTraceCount() const
+  {
+    return m_nMoveTraces;
+  }
+
+  uint64_t
+  GetCacheHitCount() const
+  {
+    return m_nCacheHits;
+  }
+
+  uint64_t
+  GetCacheMissCount() const
+  {
+    return m_nCacheMisses;
+  }
+
+  uint64_t
+  GetServedBytes() const
+  {
+    return m_nServedBytes;
+  }
+
 protected:
   // inherited from Application base class.
   virtual void
@@ -74,11 +149,67 @@ protected:
   std::string
   GetRandomize() const;
 
+  /**
+   * @brief Sends a trace now, or as soon as MinTraceInterval allows, and restarts the keepalive
+   */
+  void
+  TriggerTrace();
+
+  void
+  OnCourseChange(Ptr<const MobilityModel> mobility);
+
+  void
+  OnAssociation(Mac48Address bssid);
+
+  /**
+   * @brief Checks for a cell change, and schedules the next check at the next cell boundary
+   */
+  void
+  CheckCell();
+
+  /**
+   * @brief Number of segments of the object, 0 if no object is configured
+   */
+  uint32_t
+  GetSegmentCount() const;
+
+  /**
+   * @brief Returns the Data packet of a segment, from the packet cache or built on a miss
+   * @return nullptr if the object has no such segment
+   */
+  shared_ptr<const Data>
+  GetSegment(uint32_t seq);
+
+  /**
+   * @brief Builds, encodes and signs the Data packet of a segment
+   */
+  shared_ptr<const Data>
+  MakeSegment(uint32_t seq) const;
+
+  /**
+   * @brief Keeps a built segment, dropping the least recently pulled one beyond the cache limit
+   */
+  void
+  CacheSegment(uint32_t seq, shared_ptr<const Data> data);
+
+  /**
+   * @brief Fills the packet cache with the segments the server asks for first
+   */
+  void
+  BuildSegmentCache();
+
+  /**
+   * @brief Source segment of a coded group, read from the payload source
+   */
+  KiteFecCoder::Symbol
+  ReadSourceSymbol(uint32_t sourceSeq) const;
+
 private:
   Name m_serverPrefix;
   Name m_mobilePrefix;
   Time m_traceLifeTime; // LifeTime for interest packet(IFI)
   Time m_sendFrequency; // Interval between every two interests
+  Time m_startJitter;
 
   Ptr<UniformRandomVariable> m_rand; ///< @brief nonce generator
   Ptr<RandomVariableStream> m_random;
@@ -86,6 +217,43 @@ private:
   
   int m_seq;
 
+  bool m_traceOnMove;
+  double m_cellSize; // meters, 0 disables position-based cells
+  Time m_keepaliveInterval;
+  Time m_minTraceInterval;
+
+  EventId m_traceEvent;
+  EventId m_cellCheckEvent;
+  Time m_lastTraceTime;
+  bool m_hasCell;
+  int64_t m_cellX;
+  int64_t m_cellY;
+  bool m_isMoveTrace; // the pending trace is due to a move
+
+  uint64_t m_nTraces;
+  uint64_t m_nMoveTraces;
+
+  uint32_t m_fecK; // 0 disables coding
+  uint32_t m_fecN;
+  shared_ptr<KiteFecCoder> m_fec;
+
+  bool m_signRequests;
+  Time m_keyEpoch;
+
+  uint64_t m_objectSize; // in bytes
+  std::string m_payloadFile;
+  shared_ptr<KitePayloadSource> m_payload; // nullptr to answer with virtual payload
+  uint32_t m_maxCachedSegments; // 0 for the whole object
+  uint32_t m_segmentCacheLimit;
+  uint32_t m_segmentSize;  // PayloadSize of the Producer
+  Time m_segmentFreshness; // Freshness of the Producer
+  std::list<uint32_t> m_segmentOrder; // least recently pulled first
+  std::unordered_map<uint32_t, std::pair<shared_ptr<const Data>, std::list<uint32_t>::iterator>> m_segments;
+
+  uint64_t m_nCacheHits;
+  uint64_t m_nCacheMisses;
+  uint64_t m_nServedBytes;
+
 
   //copy from class Producer
   /*Name m_prefix;
@@ -31,6 +31,12 @@
 
 #include "helper/ndn-fib-helper.hpp"
 
+#include "ndn-kite-request-signer.h"
+
+#include <ndn-cxx/lp/tags.hpp>
+
+#include <algorithm>
+
 NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteUploadServer");
 
 namespace ns3 {
@@ -56,12 +62,57 @@ KiteUploadServer::GetTypeId(void)
       .AddAttribute("TracingInterestLifeTime", "LifeTime for trace Interest packet", StringValue("4s"),
                     MakeTimeAccessor(&KiteUploadServer::m_tracingInterestLifeTime), MakeTimeChecker())
 
+      .AddAttribute("SegmentedUpload", "Pull consecutive segments with a window of tracing Interests",
+                    BooleanValue(false),
+                    MakeBooleanAccessor(&KiteUploadServer::m_segmentedUpload), MakeBooleanChecker())
+      .AddAttribute("InitialWindow", "Initial number of outstanding tracing Interests", UintegerValue(1),
+                    MakeUintegerAccessor(&KiteUploadServer::m_initialWindow), MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("MaxWindow", "Upper bound of the window", UintegerValue(64),
+                    MakeUintegerAccessor(&KiteUploadServer::m_maxWindow), MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("InitialRto", "Retransmission timeout of a session before its first RTT sample",
+                    StringValue("1s"),
+                    MakeTimeAccessor(&KiteUploadServer::m_initialRto), MakeTimeChecker())
+      .AddAttribute("MinRto", "Lower bound of the retransmission timeout", StringValue("100ms"),
+                    MakeTimeAccessor(&KiteUploadServer::m_minRto), MakeTimeChecker())
+
+      .AddAttribute("FecK", "Source segments per erasure-coded group, 0 to pull plain segments",
+                    UintegerValue(0),
+                    MakeUintegerAccessor(&KiteUploadServer::m_fecK), MakeUintegerChecker<uint32_t>())
+      .AddAttribute("FecN", "Coded segments per group, at most 256", UintegerValue(0),
+                    MakeUintegerAccessor(&KiteUploadServer::m_fecN), MakeUintegerChecker<uint32_t>(0, 256))
+
+      .AddAttribute("VerifyRequests", "Only serve upload requests signed by the requesting mobile",
+                    BooleanValue(false),
+                    MakeBooleanAccessor(&KiteUploadServer::m_verifyRequests), MakeBooleanChecker())
+      .AddAttribute("VerificationCacheLifetime", "How long a verified (key, TraceName) is trusted",
+                    StringValue("60s"),
+                    MakeTimeAccessor(&KiteUploadServer::m_verificationCacheLifetime), MakeTimeChecker())
+
     ;
 
   return tid;
 }
 
 KiteUploadServer::KiteUploadServer()
+  : m_segmentedUpload(false)
+  , m_initialWindow(1)
+  , m_maxWindow(64)
+  , m_fecK(0)
+  , m_fecN(0)
+  , m_verifyRequests(false)
+  , m_nCompletedSessions(0)
+  , m_nReceivedSegments(0)
+  , m_nRetransmissions(0)
+  , m_nSpuriousRetransmissions(0)
+  , m_nLateData(0)
+  , m_nRttResets(0)
+  , m_nResumes(0)
+  , m_nDuplicateBytes(0)
+  , m_nRepairs(0)
+  , m_nDecodedGroups(0)
+  , m_nVerifications(0)
+  , m_nVerificationCacheHits(0)
+  , m_nRejectedRequests(0)
 {
   NS_LOG_FUNCTION_NOARGS();
 
@@ -76,6 +127,32 @@ KiteUploadServer::StartApplication()
   App::StartApplication();
 
   FibHelper::AddRoute(GetNode(), m_serverPrefix, m_face, 0);
+
+  if (m_segmentedUpload && m_fecK > 0) {
+    m_fec = make_shared<KiteFecCoder>(m_fecK, std::max(m_fecN, m_fecK));
+    m_fecN = m_fec->GetN();
+  }
+
+  if (m_verifyRequests && m_verificationCacheLifetime.IsStrictlyPositive()) {
+    m_purgeEvent = Simulator::Schedule(m_verificationCacheLifetime, &KiteUploadServer::PurgeVerificationCache, this);
+  }
+}
+
+void
+KiteUploadServer::StopApplication()
+{
+  NS_LOG_FUNCTION_NOARGS();
+
+  Simulator::Cancel(m_purgeEvent);
+  for (auto& entry : m_sessions) {
+    UploadSession& session = *entry.second;
+    Simulator::Cancel(session.sendEvent);
+    for (auto& pending : session.pending) {
+      Simulator::Cancel(pending.second.timeoutEvent);
+    }
+  }
+
+  Consumer::StopApplication();
 }
 
 void
@@ -100,7 +177,32 @@ KiteUploadServer::OnInterest(shared_ptr<const Interest> interest)
 
   // Consumer::SendPacket(); // non-traceable Interest packet
   if (int(interest->getTraceFlag()) == 1){
-    SendPacket(2, interest->getName());
+    if (m_verifyRequests && !IsAuthenticRequest(*interest)) {
+      m_nRejectedRequests++;
+      NS_LOG_INFO("SERVER: Dropping unverified upload request: " << interest->getName());
+      return;
+    }
+
+    if (m_segmentedUpload) {
+      // the mobile identifies itself by the TraceName of its upload request
+      const Name& dataPrefix = interest->hasTraceName() ? interest->getTraceName() : m_interestName;
+      shared_ptr<UploadSession> session = GetSession(dataPrefix);
+      bool hasMoved = CheckHandover(session, *interest);
+      // the latest upload request is where the mobile is, keep the window going along it
+      session->traceName = interest->getName();
+      if (hasMoved) {
+        ResumeSession(session);
+      }
+      ScheduleNextSegment(session);
+    }
+    else {
+      // with several mobiles under the server's prefix, pull from the one that sent the request
+      Name dataName;
+      if (interest->hasTraceName() && m_interestName.isPrefixOf(interest->getTraceName())) {
+        dataName = interest->getTraceName();
+      }
+      SendPacket(2, interest->getName(), dataName);
+    }
   } // send out a traceable Interest packet
   else{
     //send a Data Packet;
@@ -108,7 +210,7 @@ KiteUploadServer::OnInterest(shared_ptr<const Interest> interest)
 }
 
 void
-KiteUploadServer::SendPacket(uint8_t traceFlag, Name traceName)
+KiteUploadServer::SendPacket(uint8_t traceFlag, Name traceName, Name dataName)
 {
   if (!m_active)
     return;
@@ -134,7 +236,7 @@ KiteUploadServer::SendPacket(uint8_t traceFlag, Name traceName)
   }
 
   //
-  shared_ptr<Name> nameWithSequence = make_shared<Name>(m_interestName);
+  shared_ptr<Name> nameWithSequence = make_shared<Name>(dataName.empty() ? m_interestName : dataName);
   //skip adding traceName's sequence number for testing mobile supporting -- move before getting
   //if sequence number in every traceName is same, when mobility move before receiving tracing-interest, the tracing-interest should be pulled at the middle router.
   //nameWithSequence->appendSequenceNumber(seq);
@@ -170,7 +272,404 @@ KiteUploadServer::SendPacket(uint8_t traceFlag, Name traceName)
 
 void KiteUploadServer::OnData(shared_ptr<const Data> data){
   NS_LOG_INFO("\nSERVER: Receive Data: " << data->getName());
-  Consumer::OnData(data);
+
+  if (!m_segmentedUpload) {
+    if (!data->getName().empty() && data->getName()[-1].isSequenceNumber()) {
+      Consumer::OnData(data);
+    }
+    else {
+      App::OnData(data); // single unsegmented pull, nothing to account
+    }
+    return;
+  }
+
+  App::OnData(data); // tracing inside
+
+  const Name& dataName = data->getName();
+  if (dataName.empty() || !dataName[-1].isSequenceNumber()) {
+    return;
+  }
+
+  auto it = m_sessions.find(dataName.getPrefix(-1));
+  if (it == m_sessions.end()) {
+    NS_LOG_INFO("SERVER: Data for no session: " << dataName);
+    return;
+  }
+
+  OnSegmentData(it->second, dataName[-1].toSequenceNumber(), *data);
+}
+
+bool
+KiteUploadServer::IsAuthenticRequest(const Interest& request)
+{
+  VerificationKey key;
+  uint64_t tag;
+  if (!KiteRequestSigner::Parse(request, key.keyName, tag)) {
+    return false;
+  }
+  key.traceName = request.getTraceName();
+
+  auto it = m_verificationCache.find(key);
+  if (it != m_verificationCache.end() && it->second.expiry > Simulator::Now() && it->second.tag == tag) {
+    m_nVerificationCacheHits++;
+    return true;
+  }
+
+  m_nVerifications++;
+  if (!KiteRequestSigner::Verify(request)) {
+    return false;
+  }
+
+  VerifiedRequest& verified = m_verificationCache[key];
+  verified.tag = tag;
+  verified.expiry = Simulator::Now() + m_verificationCacheLifetime;
+  return true;
+}
+
+void
+KiteUploadServer::PurgeVerificationCache()
+{
+  for (auto it = m_verificationCache.begin(); it != m_verificationCache.end();) {
+    if (it->second.expiry <= Simulator::Now()) {
+      it = m_verificationCache.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  m_purgeEvent = Simulator::Schedule(m_verificationCacheLifetime, &KiteUploadServer::PurgeVerificationCache, this);
+}
+
+shared_ptr<KiteUploadServer::UploadSession>
+KiteUploadServer::GetSession(const Name& dataPrefix)
+{
+  auto it = m_sessions.find(dataPrefix);
+  if (it != m_sessions.end()) {
+    return it->second;
+  }
+
+  auto session = make_shared<UploadSession>();
+  session->dataPrefix = dataPrefix;
+  session->seq = 0;
+  session->seqMax = m_seqMax;
+  session->window = m_initialWindow;
+  session->lastDecrease = Seconds(0);
+  session->rtt = make_shared<KiteRttEstimator>(m_initialRto, m_minRto, m_tracingInterestLifeTime);
+  session->hopCount = -1;
+  session->nTimeouts = 0;
+  session->nDecodedGroups = 0;
+  session->nReceived = 0;
+  session->isDone = false;
+
+  m_sessions.emplace(dataPrefix, session);
+  NS_LOG_INFO("SERVER: New upload session for " << dataPrefix << ", sessions: " << m_sessions.size());
+  return session;
+}
+
+bool
+KiteUploadServer::CheckHandover(shared_ptr<UploadSession> session, const Interest& request)
+{
+  int hopCount = -1;
+  auto hopCountTag = request.getTag<::ndn::lp::HopCountTag>();
+  if (hopCountTag != nullptr) {
+    hopCount = *hopCountTag;
+  }
+
+  // the path length changed, or the old path stopped delivering
+  bool hasMoved = (hopCount != -1 && session->hopCount != -1 && hopCount != session->hopCount)
+                  || session->nTimeouts > 0;
+
+  if (hasMoved && session->rtt->HasSample()) {
+    NS_LOG_INFO("SERVER: " << session->dataPrefix << " moved (hops " << session->hopCount << " -> " << hopCount
+                << ", timeouts " << session->nTimeouts << "), resetting RTT, srtt was "
+                << session->rtt->GetSrtt().GetMilliSeconds() << "ms");
+    session->rtt->Reset();
+    m_nRttResets++;
+  }
+
+  if (hopCount != -1) {
+    session->hopCount = hopCount;
+  }
+  session->nTimeouts = 0;
+  return hasMoved;
+}
+
+void
+KiteUploadServer::ResumeSession(shared_ptr<UploadSession> session)
+{
+  if (session->isDone) {
+    return;
+  }
+
+  std::map<uint32_t, PendingSegment> pending;
+  pending.swap(session->pending);
+  for (auto& segment : pending) {
+    Simulator::Cancel(segment.second.timeoutEvent);
+    RequeueSegment(session, segment.first);
+  }
+  m_nResumes++;
+
+  NS_LOG_INFO("SERVER: Resuming " << session->dataPrefix << " at " << session->seq << ", received "
+              << session->nReceived << ", re-pulling " << session->retxSeqs.size() + session->repairSeqs.size());
+}
+
+bool
+KiteUploadServer::HasFreshSegment(const UploadSession& session) const
+{
+  if (m_fec == nullptr) {
+    return session.seq < session.seqMax;
+  }
+
+  // MaxSeq source segments, rounded up to whole groups
+  uint64_t groupCount = (static_cast<uint64_t>(m_seqMax) + m_fecK - 1) / m_fecK;
+  return session.seq / m_fecN < groupCount;
+}
+
+void
+KiteUploadServer::RequeueSegment(shared_ptr<UploadSession> session, uint32_t seq)
+{
+  if (IsObsolete(*session, seq)) {
+    return;
+  }
+
+  if (m_fec != nullptr) {
+    uint32_t groupNo = seq / m_fecN;
+    FecGroup& group = session->fecGroups[groupNo];
+    if (m_fecK + group.nRepairs < m_fecN) {
+      // any other coded segment of the group is as good as the lost one
+      session->repairSeqs.insert(groupNo * m_fecN + m_fecK + group.nRepairs++);
+      return;
+    }
+  }
+
+  session->retxSeqs.insert(seq);
+}
+
+bool
+KiteUploadServer::IsObsolete(const UploadSession& session, uint32_t seq) const
+{
+  if (IsReceived(session, seq)) {
+    return true;
+  }
+
+  if (m_fec != nullptr) {
+    auto it = session.fecGroups.find(seq / m_fecN);
+    return it != session.fecGroups.end() && it->second.isDecoded;
+  }
+  return false;
+}
+
+void
+KiteUploadServer::OnFecSymbol(shared_ptr<UploadSession> session, uint32_t seq, const Data& data)
+{
+  uint32_t groupNo = seq / m_fecN;
+  FecGroup& group = session->fecGroups[groupNo];
+
+  const ::ndn::Block& content = data.getContent();
+  group.symbols[seq % m_fecN] = KiteFecCoder::Symbol(content.value_begin(), content.value_end());
+  if (group.symbols.size() < m_fecK) {
+    return;
+  }
+
+  std::vector<KiteFecCoder::Symbol> source;
+  if (!m_fec->Decode(group.symbols, source)) {
+    return;
+  }
+
+  NS_LOG_INFO("SERVER: Decoded group " << groupNo << " of " << session->dataPrefix
+              << " from " << group.symbols.size() << " segments");
+  group.isDecoded = true;
+  group.symbols.clear();
+  session->nDecodedGroups++;
+  m_nDecodedGroups++;
+
+  // whatever of the group is still in flight is not needed any more
+  auto it = session->pending.lower_bound(groupNo * m_fecN);
+  while (it != session->pending.end() && it->first < (groupNo + 1) * m_fecN) {
+    Simulator::Cancel(it->second.timeoutEvent);
+    it = session->pending.erase(it);
+  }
+}
+
+void
+KiteUploadServer::ScheduleNextSegment(shared_ptr<UploadSession> session)
+{
+  if (session->isDone || session->traceName.empty()) {
+    return;
+  }
+
+  if (session->pending.size() >= static_cast<uint32_t>(session->window)) {
+    return; // window full, refilled on Data or timeout
+  }
+
+  if (!session->sendEvent.IsRunning()) {
+    session->sendEvent = Simulator::ScheduleNow(&KiteUploadServer::SendSegment, this, session);
+  }
+}
+
+void
+KiteUploadServer::SendSegment(shared_ptr<UploadSession> session)
+{
+  if (!m_active)
+    return;
+
+  uint32_t seq = std::numeric_limits<uint32_t>::max(); // invalid
+
+  while (!session->repairSeqs.empty() && IsObsolete(*session, *session->repairSeqs.begin())) {
+    session->repairSeqs.erase(session->repairSeqs.begin());
+  }
+  while (!session->retxSeqs.empty() && IsObsolete(*session, *session->retxSeqs.begin())) {
+    session->retxSeqs.erase(session->retxSeqs.begin());
+  }
+
+  if (!session->repairSeqs.empty()) {
+    seq = *session->repairSeqs.begin();
+    session->repairSeqs.erase(session->repairSeqs.begin());
+    m_nRepairs++;
+  }
+  else if (!session->retxSeqs.empty()) {
+    seq = *session->retxSeqs.begin();
+    session->retxSeqs.erase(session->retxSeqs.begin());
+    session->retxCounts[seq]++;
+    m_nRetransmissions++;
+  }
+  else if (HasFreshSegment(*session)) {
+    seq = session->seq++;
+    if (m_fec != nullptr && session->seq % m_fecN == m_fecK) {
+      session->seq += m_fecN - m_fecK; // coded segments of a group are only pulled to replace lost ones
+    }
+  }
+  else {
+    return; // everything requested, waiting for the window to drain
+  }
+
+  Name name(session->dataPrefix);
+  name.appendSequenceNumber(seq);
+
+  shared_ptr<Interest> interest = make_shared<Interest>();
+  interest->setNonce(m_rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
+  interest->setName(name);
+  // no point in keeping PIT entries along the trace after we have given up on them
+  Time rto = session->rtt->GetRto();
+  time::milliseconds interestLifeTime(rto.GetMilliSeconds());
+  interest->setInterestLifetime(interestLifeTime);
+  interest->setTraceName(session->traceName);
+  interest->setTraceFlag(2);
+
+  PendingSegment& pending = session->pending[seq];
+  pending.sentTime = Simulator::Now();
+  pending.timeoutEvent = Simulator::Schedule(rto, &KiteUploadServer::OnSegmentTimeout, this, session, seq);
+
+  NS_LOG_INFO("SERVER: Requesting segment " << seq << " of " << session->dataPrefix
+              << ", window: " << session->window << ", in flight: " << session->pending.size());
+
+  m_transmittedInterests(interest, this, m_face);
+  m_appLink->onReceiveInterest(*interest);
+
+  ScheduleNextSegment(session);
+}
+
+void
+KiteUploadServer::OnSegmentData(shared_ptr<UploadSession> session, uint32_t seq, const Data& data)
+{
+  if (IsObsolete(*session, seq)) {
+    m_nDuplicateBytes += data.wireEncode().size();
+    NS_LOG_INFO("SERVER: Duplicate segment " << seq << " of " << session->dataPrefix);
+    return;
+  }
+
+  bool isRetransmitted = session->retxCounts.count(seq) > 0;
+
+  auto it = session->pending.find(seq);
+  if (it != session->pending.end()) {
+    Time rtt = Simulator::Now() - it->second.sentTime;
+    if (!isRetransmitted) {
+      session->rtt->AddSample(rtt); // Karn: ambiguous samples are never taken
+    }
+    else if (session->rtt->HasSample() && rtt < session->rtt->GetSrtt() / 2) {
+      // too fast to answer the retransmission, the original made it after all
+      m_nSpuriousRetransmissions++;
+    }
+    Simulator::Cancel(it->second.timeoutEvent);
+    session->pending.erase(it);
+  }
+  else if (session->retxSeqs.erase(seq) > 0) {
+    m_nLateData++; // timed out before being sent again
+  }
+  else if (m_fec != nullptr && seq / m_fecN < (session->seq + m_fecN - 1) / m_fecN) {
+    m_nLateData++; // timed out and replaced by a coded segment, still counts for its group
+  }
+  else {
+    return; // never requested
+  }
+  session->retxCounts.erase(seq);
+  if (seq >= session->received.size()) {
+    session->received.resize(seq + 1, false);
+  }
+  session->received[seq] = true;
+  session->nReceived++;
+  m_nReceivedSegments++;
+
+  if (m_fec != nullptr) {
+    OnFecSymbol(session, seq, data);
+  }
+  else if (data.getFinalBlockId().isSequenceNumber()) {
+    OnFinalBlockId(session, data.getFinalBlockId().toSequenceNumber());
+  }
+
+  // additive increase
+  session->window = std::min<double>(session->window + 1.0 / session->window, m_maxWindow);
+
+  if (!HasFreshSegment(*session) && session->pending.empty()
+      && session->retxSeqs.empty() && session->repairSeqs.empty()) {
+    session->isDone = true;
+    m_nCompletedSessions++;
+    NS_LOG_INFO("SERVER: Upload of " << session->dataPrefix << " complete, " << session->nReceived << " segments");
+    return;
+  }
+
+  ScheduleNextSegment(session);
+}
+
+void
+KiteUploadServer::OnFinalBlockId(shared_ptr<UploadSession> session, uint64_t finalSeq)
+{
+  if (finalSeq >= session->seqMax) {
+    return;
+  }
+  session->seqMax = finalSeq + 1;
+  session->seq = std::min(session->seq, session->seqMax);
+
+  // segments past the end are never answered
+  for (auto it = session->pending.lower_bound(session->seqMax); it != session->pending.end();) {
+    Simulator::Cancel(it->second.timeoutEvent);
+    it = session->pending.erase(it);
+  }
+  session->retxSeqs.erase(session->retxSeqs.lower_bound(session->seqMax), session->retxSeqs.end());
+
+  NS_LOG_INFO("SERVER: " << session->dataPrefix << " ends at segment " << finalSeq);
+}
+
+void
+KiteUploadServer::OnSegmentTimeout(shared_ptr<UploadSession> session, uint32_t seq)
+{
+  NS_LOG_INFO("SERVER: Timeout for segment " << seq << " of " << session->dataPrefix);
+
+  auto it = session->pending.find(seq);
+  Time sentTime = it->second.sentTime;
+  session->pending.erase(it);
+  RequeueSegment(session, seq);
+  session->nTimeouts++;
+
+  // multiplicative decrease, once for all the segments in flight when the loss started
+  if (sentTime >= session->lastDecrease) {
+    session->window = std::max<double>(session->window / 2, 1.0);
+    session->rtt->Backoff();
+    session->lastDecrease = Simulator::Now();
+  }
+
+  ScheduleNextSegment(session);
 }
 
 } // namespace ndn
@@ -23,6 +23,15 @@
 #include "ns3/ndnSIM/model/ndn-common.hpp"
 
 #include "ns3/ndnSIM/apps/ndn-consumer.hpp"
+#include "ndn-kite-rtt-estimator.h"
+#include "ndn-kite-fec.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 namespace ndn {
@@ -32,9 +41,26 @@ namespace ndn {
  * @brief Ndn application that runs as the stationary server in upload scenarios supporting Kite scheme.
  * This one is a server application, it waits for Interest packets from mobile nodes that serve as upload requests,
  * It then sends out Interest towards the mobile node to pull the data it tries to upload.
- * Currently, the name of the uploading mobile node is fixed.
- * Eventually the upload request should include information about the mobile node,
- * and certain verification machanisms should be applied so that this won't be exploited to conduct DDoS attacks.
+ * Without SegmentedUpload, the name of the uploading mobile node is fixed (Prefix), and one tracing Interest
+ * is sent per upload request.
+ * With SegmentedUpload, every mobile gets its own upload session, keyed by the TraceName of its upload request
+ * (the mobile's prefix). The server pulls consecutive segments <TraceName>/<seq> of the mobile's object,
+ * keeping an AIMD window of outstanding tracing Interests per session that is refilled on every Data,
+ * with its own RTT estimator and retransmission queue. The window is halved and the RTO backed off once
+ * per loss event: timeouts of segments sent before the last decrease only requeue them.
+ * Without FEC, a session ends at the FinalBlockId of the mobile's segments if that comes before MaxSeq.
+ * The estimator follows Karn's rule and is reset when the mobile hands over (its upload request
+ * arrives over a different number of hops, or segments timed out since the previous request).
+ * Tracing Interests live as long as the session's retransmission timeout, capped by TracingInterestLifeTime.
+ * Every session keeps a bitmap of received segments. After a handover the in-flight window, sent along
+ * the old path, is pulled again right away; segments that already arrived are never requested again.
+ * With FecK set (and the same FecK/FecN on the mobiles), MaxSeq counts source segments, pulled in groups
+ * of FecK. A lost segment is replaced by pulling a new coded segment of its group, and a group is
+ * decoded as soon as any FecK of its segments arrived.
+ * With VerifyRequests, only upload requests signed by the mobile named in their TraceName are served,
+ * so that this won't be exploited to conduct DDoS attacks. Since mobiles repeat their request periodically,
+ * verification results are cached per (key, TraceName) for VerificationCacheLifetime: a mobile is
+ * verified once per key epoch and its repeated requests cost a hash lookup.
  */
 class KiteUploadServer : public Consumer {
 public:
@@ -50,28 +76,333 @@ public:
 
   virtual void 
   OnData(shared_ptr<const Data> data);
+
   /**
    * @brief Actually send packet, with TraceFlag option
+   * @param dataName name to pull, the server's prefix if empty
    */
   void
-  SendPacket(uint8_t traceFlag, Name traceName);
+  SendPacket(uint8_t traceFlag, Name traceName, Name dataName = Name());
+
+public: // statistics
+  size_t
+  GetSessionCount() const
+  {
+    return m_sessions.size();
+  }
+
+  uint32_t
+  GetCompletedSessionCount() const
+  {
+    return m_nCompletedSessions;
+  }
+
+  uint64_t
+  GetReceivedSegmentCount() const
+  {
+    return m_nReceivedSegments;
+  }
+
+  uint64_t
+  GetRetransmissionCount() const
+  {
+    return m_nRetransmissions;
+  }
+
+  /**
+   * @brief Retransmissions answered by Data sooner than half an RTT, i.e., the original was not lost
+   */
+  uint64_t
+  GetSpuriousRetransmissionCount() const
+  {
+    return m_nSpuriousRetransmissions;
+  }
+
+  /**
+   * @brief Data that arrived after its tracing Interest had timed out
+   */
+  uint64_t
+  GetLateDataCount() const
+  {
+    return m_nLateData;
+  }
+
+  uint32_t
+  GetRttResetCount() const
+  {
+    return m_nRttResets;
+  }
+
+  uint32_t
+  GetResumeCount() const
+  {
+    return m_nResumes;
+  }
+
+  /**
+   * @brief Bytes of Data received more than once
+   */
+  uint64_t
+  GetDuplicateBytes() const
+  {
+    return m_nDuplicateBytes;
+  }
+
+  /**
+   * @brief Coded segments pulled in place of lost ones
+   */
+  uint64_t
+  GetRepairCount() const
+  {
+    return m_nRepairs;
+  }
+
+  uint64_t
+  GetDecodedGroupCount() const
+  {
+    return m_nDecodedGroups;
+  }
+
+  /**
+   * @brief Signatures actually checked, i.e., verification cache misses
+   */
+  uint64_t
+  GetVerificationCount() const
+  {
+    return m_nVerifications;
+  }
+
+  uint64_t
+  GetVerificationCacheHitCount() const
+  {
+    return m_nVerificationCacheHits;
+  }
+
+  uint64_t
+  GetRejectedRequestCount() const
+  {
+    return m_nRejectedRequests;
+  }
 
 protected:
   // from App
   virtual void
   StartApplication();
 
+  virtual void
+  StopApplication();
+
   /**
    * \brief Actually does nothing.
    */
   virtual void
   ScheduleNextPacket() {};
 
+protected:
+  /**
+   * @brief An outstanding tracing Interest of a session
+   */
+  struct PendingSegment
+  {
+    Time sentTime; // of the latest transmission
+    EventId timeoutEvent;
+  };
+
+  /**
+   * @brief Erasure-coded group of a session
+   */
+  struct FecGroup
+  {
+    uint32_t nRepairs; // coded segments k..k+nRepairs-1 have been requested
+    std::map<uint32_t, KiteFecCoder::Symbol> symbols; // received, by index in the group
+    bool isDecoded;
+
+    FecGroup()
+      : nRepairs(0)
+      , isDecoded(false)
+    {
+    }
+  };
+
+  /**
+   * @brief Upload state of one mobile
+   */
+  struct UploadSession
+  {
+    Name dataPrefix; // segments are named <dataPrefix>/<seq>
+    Name traceName;  // name of the latest upload request, TraceName of the tracing Interests
+    uint32_t seq;    // next segment never requested
+    uint32_t seqMax; // MaxSeq, until a segment's FinalBlockId tells the end of the object
+    double window;
+    Time lastDecrease;     // of the window, losses of segments sent before it are the same event
+    std::set<uint32_t> retxSeqs;                 // timed out, waiting to be sent again
+    std::map<uint32_t, PendingSegment> pending;  // in flight
+    std::map<uint32_t, uint32_t> retxCounts;     // segments sent more than once
+    std::vector<bool> received;                  // indexed by seq
+    std::set<uint32_t> repairSeqs;               // coded replacements of lost segments, with FEC
+    std::map<uint32_t, FecGroup> fecGroups;      // by group number, with FEC
+    uint32_t nDecodedGroups;
+    shared_ptr<KiteRttEstimator> rtt;
+    int hopCount;          // of the latest upload request, -1 if unknown
+    uint32_t nTimeouts;    // since the latest upload request
+    EventId sendEvent;
+    uint32_t nReceived;
+    bool isDone;
+  };
+
+  /**
+   * @brief Checks the signature of an upload request, through the verification cache
+   */
+  bool
+  IsAuthenticRequest(const Interest& request);
+
+  /**
+   * @brief Drops expired verification results, rescheduled every VerificationCacheLifetime
+   */
+  void
+  PurgeVerificationCache();
+
+  /**
+   * @brief Returns the session for a mobile prefix, creating it on first use
+   */
+  shared_ptr<UploadSession>
+  GetSession(const Name& dataPrefix);
+
+  /**
+   * @brief Schedules the next tracing Interest of a session if its window allows
+   */
+  void
+  ScheduleNextSegment(shared_ptr<UploadSession> session);
+
+  /**
+   * @brief Sends one tracing Interest of a session, retransmissions first
+   */
+  void
+  SendSegment(shared_ptr<UploadSession> session);
+
+  /**
+   * @brief Resets the session RTT estimator if the upload request shows the mobile has moved
+   * @return whether the mobile has moved
+   */
+  bool
+  CheckHandover(shared_ptr<UploadSession> session, const Interest& request);
+
+  /**
+   * @brief Whether a session still has segments never requested
+   */
+  bool
+  HasFreshSegment(const UploadSession& session) const;
+
+  /**
+   * @brief Queues a lost segment to be pulled again, or a new coded segment of its group in its place
+   */
+  void
+  RequeueSegment(shared_ptr<UploadSession> session, uint32_t seq);
+
+  /**
+   * @brief Whether a segment is no longer needed, because it arrived or its group is decoded
+   */
+  bool
+  IsObsolete(const UploadSession& session, uint32_t seq) const;
+
+  /**
+   * @brief Stores a coded segment and decodes its group once FecK segments are in
+   */
+  void
+  OnFecSymbol(shared_ptr<UploadSession> session, uint32_t seq, const Data& data);
+
+  /**
+   * @brief Ends a session without FEC at the last segment of the mobile's object
+   */
+  void
+  OnFinalBlockId(shared_ptr<UploadSession> session, uint64_t finalSeq);
+
+  /**
+   * @brief Re-pulls the in-flight window along the new trace, without waiting for it to time out
+   */
+  void
+  ResumeSession(shared_ptr<UploadSession> session);
+
+  bool
+  IsReceived(const UploadSession& session, uint32_t seq) const
+  {
+    return seq < session.received.size() && session.received[seq];
+  }
+
+  void
+  OnSegmentData(shared_ptr<UploadSession> session, uint32_t seq, const Data& data);
+
+  void
+  OnSegmentTimeout(shared_ptr<UploadSession> session, uint32_t seq);
+
 protected:
   // m_interestName inherited from Consumer
   // Name mobilePrefix;
   Name m_serverPrefix;
   Time m_tracingInterestLifeTime;
+
+  bool m_segmentedUpload;
+  uint32_t m_initialWindow;
+  uint32_t m_maxWindow;
+  Time m_initialRto;
+  Time m_minRto;
+
+  uint32_t m_fecK; // 0 disables coding
+  uint32_t m_fecN;
+  shared_ptr<KiteFecCoder> m_fec;
+
+  struct VerificationKey
+  {
+    Name keyName;
+    Name traceName;
+
+    bool
+    operator==(const VerificationKey& other) const
+    {
+      return keyName == other.keyName && traceName == other.traceName;
+    }
+  };
+
+  struct VerificationKeyHash
+  {
+    size_t
+    operator()(const VerificationKey& key) const
+    {
+      size_t seed = 0;
+      for (const Name* name : {&key.keyName, &key.traceName}) {
+        for (const name::Component& component : *name) {
+          boost::hash_combine(seed, boost::hash_range(component.value_begin(), component.value_end()));
+        }
+      }
+      return seed;
+    }
+  };
+
+  struct VerifiedRequest
+  {
+    uint64_t tag;
+    Time expiry;
+  };
+
+  bool m_verifyRequests;
+  Time m_verificationCacheLifetime;
+  std::unordered_map<VerificationKey, VerifiedRequest, VerificationKeyHash> m_verificationCache;
+  EventId m_purgeEvent;
+
+  std::map<Name, shared_ptr<UploadSession>> m_sessions; // keyed by dataPrefix
+  uint32_t m_nCompletedSessions;
+  uint64_t m_nReceivedSegments;
+  uint64_t m_nRetransmissions;
+  uint64_t m_nSpuriousRetransmissions;
+  uint64_t m_nLateData;
+  uint32_t m_nRttResets;
+  uint32_t m_nResumes;
+  uint64_t m_nDuplicateBytes;
+  uint64_t m_nRepairs;
+  uint64_t m_nDecodedGroups;
+  uint64_t m_nVerifications;
+  uint64_t m_nVerificationCacheHits;
+  uint64_t m_nRejectedRequests;
 };
 
 } // namespace ndn
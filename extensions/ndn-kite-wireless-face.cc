@@ -0,0 +1,61 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#include "ndn-kite-wireless-face.h"
+#include "ns3/log.h"
+#include "ns3/mac48-address.h"
+
+#include "model/ndn-net-device-transport.hpp"
+#include "face/generic-link-service.hpp"
+
+#include <boost/lexical_cast.hpp>
+
+NS_LOG_COMPONENT_DEFINE("ndn.kite.KiteWirelessFace");
+
+namespace ns3 {
+namespace ndn {
+
+static std::string
+constructFaceUri(Ptr<NetDevice> netDevice)
+{
+  std::string uri = "netdev://";
+  Address address = netDevice->GetAddress();
+  if (Mac48Address::IsMatchingType(address)) {
+    uri += "[" + boost::lexical_cast<std::string>(Mac48Address::ConvertFrom(address)) + "]";
+  }
+  return uri;
+}
+
+shared_ptr<Face>
+KiteWirelessFaceCallback(Ptr<Node> node, Ptr<L3Protocol> ndn, Ptr<NetDevice> netDevice)
+{
+  NS_LOG_DEBUG("Creating multi-access Face on node " << node->GetId());
+
+  ::nfd::face::GenericLinkService::Options opts;
+  opts.allowFragmentation = true;
+  opts.allowReassembly = true;
+
+  auto linkService = ::ndn::make_unique< ::nfd::face::GenericLinkService>(opts);
+
+  auto transport = ::ndn::make_unique<NetDeviceTransport>(node, netDevice,
+                                                          constructFaceUri(netDevice),
+                                                          "netdev://[ff:ff:ff:ff:ff:ff]",
+                                                          ::ndn::nfd::FACE_SCOPE_NON_LOCAL,
+                                                          ::ndn::nfd::FACE_PERSISTENCY_PERSISTENT,
+                                                          ::ndn::nfd::LINK_TYPE_MULTI_ACCESS);
+
+  auto face = std::make_shared<Face>(std::move(linkService), std::move(transport));
+  face->setMetric(1);
+
+  ndn->addFace(face);
+  NS_LOG_LOGIC("Node " << node->GetId() << ": added multi-access Face as face #" << face->getLocalUri());
+
+  return face;
+}
+
+} // namespace ndn
+} // namespace ns3
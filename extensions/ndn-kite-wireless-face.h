@@ -0,0 +1,36 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+#ifndef NDN_KITE_WIRELESS_FACE_H
+#define NDN_KITE_WIRELESS_FACE_H
+
+#include "ns3/ndnSIM/model/ndn-common.hpp"
+
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/ndnSIM/model/ndn-l3-protocol.hpp"
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Face creation callback for shared wireless media
+ *
+ * Same as the default NetDevice face, but the transport reports a multi-access link type,
+ * so that forwarding strategies can tell a shared ad-hoc channel from point-to-point links.
+ *
+ * Usage:
+ *
+ *     ndnHelper.AddFaceCreateCallback(WifiNetDevice::GetTypeId(), MakeCallback(&ndn::KiteWirelessFaceCallback));
+ */
+shared_ptr<Face>
+KiteWirelessFaceCallback(Ptr<Node> node, Ptr<L3Protocol> ndn, Ptr<NetDevice> netDevice);
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NDN_KITE_WIRELESS_FACE_H
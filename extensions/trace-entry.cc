@@ -15,9 +15,52 @@ Entry::Entry(Face& face, const Interest& interest, const shared_ptr<pit::Entry>&
   : m_face(face.shared_from_this())
   , m_interest(interest.shared_from_this()) // make sure that this interest has traceName
   , m_pitEntry(pitEntry)
+  , m_nRefreshes(0)
+  , m_lastRefreshed(time::steady_clock::now())
 {
 }
 
+void
+Entry::refresh(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry)
+{
+  BOOST_ASSERT(interest.hasTraceName());
+
+  updateFace(face);
+  m_interest = interest.shared_from_this();
+  m_pitEntry = pitEntry;
+  ++m_nRefreshes;
+  m_lastRefreshed = time::steady_clock::now();
+}
+
+void
+Entry::setMember(const Interest& interest, const shared_ptr<pit::Entry>& pitEntry)
+{
+  BOOST_ASSERT(interest.hasTraceName());
+
+  Member& member = m_members[interest.getTraceName()];
+  member.interest = interest.shared_from_this();
+  member.pitEntry = pitEntry;
+}
+
+void
+Entry::eraseMember(const Name& traceName, const shared_ptr<pit::Entry>& pitEntry)
+{
+  auto it = m_members.find(traceName);
+  if (it != m_members.end() && it->second.pitEntry == pitEntry) {
+    m_members.erase(it);
+  }
+}
+
+const Entry::Member*
+Entry::findMember(const Name& traceName) const
+{
+  auto it = m_members.find(traceName);
+  if (it == m_members.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
 bool
 Entry::matchesInterest(const Interest& interest, uint32_t flag) const
 {
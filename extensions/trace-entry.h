@@ -12,6 +12,8 @@
 #include "core/scheduler.hpp"
 #include "table/pit.hpp"
 
+#include <map>
+
 namespace nfd {
 
 namespace trace {
@@ -83,6 +85,71 @@ public: // face
       return *m_face;
   }
 
+public: // refresh
+  /** \brief refreshes the entry in place with a newer trace
+   *
+   *  Replaces the face, the representative Interest (and with it nonce and lifetime)
+   *  and the PIT entry, without reallocating the entry.
+   */
+  void
+  refresh(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry);
+
+  /** \return number of times this entry has been refreshed
+   */
+  uint64_t
+  getRefreshCount() const
+  {
+    return m_nRefreshes;
+  }
+
+  /** \return time of the last insertion or refresh
+   */
+  const time::steady_clock::TimePoint&
+  getLastRefreshed() const
+  {
+    return m_lastRefreshed;
+  }
+
+public: // members of a prefix entry
+  /** \brief the newest trace of one mobile covered by a prefix entry
+   */
+  struct Member
+  {
+    shared_ptr<const Interest> interest;
+    shared_ptr<pit::Entry> pitEntry;
+  };
+
+  /** \brief records \p interest as the newest trace of the mobile with its traceName
+   */
+  void
+  setMember(const Interest& interest, const shared_ptr<pit::Entry>& pitEntry);
+
+  /** \brief forgets the trace of \p traceName, if it is still the one of \p pitEntry
+   */
+  void
+  eraseMember(const Name& traceName, const shared_ptr<pit::Entry>& pitEntry);
+
+  /** \brief forgets the trace of \p traceName
+   */
+  void
+  eraseMember(const Name& traceName)
+  {
+    m_members.erase(traceName);
+  }
+
+  /** \return the newest trace with \p traceName, or nullptr
+   */
+  const Member*
+  findMember(const Name& traceName) const;
+
+  /** \return number of mobiles whose trace this prefix entry keeps
+   */
+  size_t
+  getMemberCount() const
+  {
+    return m_members.size();
+  }
+
 public: // hmm...
   scheduler::EventId m_timeoutTimer;
 
@@ -90,6 +157,9 @@ private:
   shared_ptr<Face> m_face;
   shared_ptr<const Interest> m_interest;
   shared_ptr<pit::Entry> m_pitEntry;
+  uint64_t m_nRefreshes;
+  time::steady_clock::TimePoint m_lastRefreshed;
+  std::map<Name, Member> m_members; // only filled in prefix entries
 };
 
 } // namespace trace
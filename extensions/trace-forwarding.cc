@@ -8,6 +8,11 @@
 #include "trace-forwarding.h"
 
 #include "core/logger.hpp"
+#include "core/random.hpp"
+
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <algorithm>
 
 NFD_LOG_INIT("TraceForwardingStrategy");
 
@@ -17,13 +22,29 @@ namespace fw {
 const Name
   TraceForwardingStrategy::STRATEGY_NAME("ndn:/localhost/nfd/strategy/trace-forwarding");
 
+size_t TraceForwardingStrategy::s_traceAggregationPrefixLength = 0;
+time::nanoseconds TraceForwardingStrategy::s_wirelessMaxDeferral = time::milliseconds(10);
+time::nanoseconds TraceForwardingStrategy::s_duplicateCacheLifetime = time::seconds(1);
+time::nanoseconds TraceForwardingStrategy::s_traceBurstWindow = time::milliseconds(10);
+
 TraceForwardingStrategy::TraceForwardingStrategy(Forwarder& forwarder, const Name& name)
   : Strategy(forwarder, name)
+  , m_nDeferred(0)
+  , m_nOverhearSuppressed(0)
+  , m_nDuplicateSuppressed(0)
+  , m_traceWindow(-1)
+  , m_nTracesInWindow(0)
+  , m_maxTracesPerWindow(0)
+  , m_nTraces(0)
 {
+  m_tt.setAggregationPrefixLength(s_traceAggregationPrefixLength);
 }
 
 TraceForwardingStrategy::~TraceForwardingStrategy()
 {
+  for (auto& transmission : m_deferredTransmissions) {
+    scheduler::cancel(transmission.second);
+  }
 }
 
 void
@@ -102,12 +123,14 @@ TraceForwardingStrategy::afterReceiveInterest(const Face& inFace, const Interest
     if (it != pitEntry->in_end()) {
       res = m_tt.insert(it->getFace(), interest, pitEntry); // the trace entry will be deleted when the interest expires, actually the IFI's lifetime is the trace entry's lifetime.
       // strategy may be responsible for updating traceEntries lifetime if necessary(interest no longer stays, eg. lifetime == 0, and new field called trace lifetime is added and set)
-      NFD_LOG_INFO("NFD: Inserted trace entry with TraceName: " << res.first->getTraceName() << ", Trace Table size: " << m_tt.size());
+      NFD_LOG_INFO("NFD: " << (res.second ? "Inserted" : "Refreshed") << " trace entry with TraceName: " << res.first->getTraceName()
+                   << ", Trace Table size: " << m_tt.size() << ", inserts: " << m_tt.getInsertCount() << ", refreshes: " << m_tt.getRefreshCount());
     }
   }
 
   // if interest is traceable with flag=1, check if the interest can pull a tracing interest to its incoming face.
   if (interest.getTraceFlag() == 1) {
+    countTrace();
     if(!Pull(inFace, interest, pitEntry)) {
       NFD_LOG_INFO("\nNFD: Can't pull interest.");
     }
@@ -132,7 +155,7 @@ TraceForwardingStrategy::afterReceiveInterest(const Face& inFace, const Interest
     //NFD_LOG_INFO("Faces: " << it->getFace());
     if (canForwardToNextHop(inFace, pitEntry, *it)) {
       //NFD_LOG_INFO("Faces: " << it->getFace());
-      this->sendInterest(pitEntry, it->getFace(), interest);
+      this->sendInterestTo(pitEntry, it->getFace(), interest);
     }
   }
 }
@@ -156,7 +179,7 @@ TraceForwardingStrategy::forwardByTFT(const Face& inFace, const Interest& intere
   int counter = 0;
   for (; it != matchedPitEntry->in_end(); it ++){
     if (it->getFace().getId() != inFace.getId() && canForwardToFace(inFace, pitEntry, it->getFace())){
-      this->sendInterest(pitEntry, it->getFace(), interest);
+      this->sendInterestTo(pitEntry, it->getFace(), interest);
       counter ++;
       NFD_LOG_INFO("out face: " << it->getFace());
     }
@@ -175,9 +198,18 @@ TraceForwardingStrategy::Pull(const Face& inFace, const Interest& interest, cons
   if (traceEntry == nullptr) {
     return false;
   }
-  const Interest& traceInterest = traceEntry->getInterest();
-
-  const shared_ptr<pit::Entry>& tracePitEntry = traceEntry->getPitEntry();
+  const Interest* traceInterest = &traceEntry->getInterest();
+  shared_ptr<pit::Entry> tracePitEntry = traceEntry->getPitEntry();
+
+  // a prefix entry stands for several mobiles, pull the trace of the one asked for
+  if (traceEntry->getTraceName() != interest.getName()) {
+    const trace::Entry::Member* member = traceEntry->findMember(interest.getName());
+    if (member == nullptr) {
+      return false;
+    }
+    traceInterest = member->interest.get();
+    tracePitEntry = member->pitEntry;
+  }
 
   //Face& face = traceEntry->getFace();
   pit::InRecordCollection::iterator it = pitEntry->getInRecord(inFace);
@@ -185,8 +217,8 @@ TraceForwardingStrategy::Pull(const Face& inFace, const Interest& interest, cons
 
   //if (it != pitEntry->in_end() && canForwardToFace(face, pitEntry, inFace)) {
   if (it != pitEntry->in_end()) {
-    NFD_LOG_INFO("NFD: Pulling to TraceName: " << traceEntry->getTraceName() << ", Face: " << it->getFace() << ", Interest: " << traceInterest);
-    this->sendInterest(tracePitEntry, it->getFace(), traceInterest);
+    NFD_LOG_INFO("NFD: Pulling to TraceName: " << traceInterest->getTraceName() << ", Face: " << it->getFace() << ", Interest: " << *traceInterest);
+    this->sendInterestTo(tracePitEntry, it->getFace(), *traceInterest);
     return true;
   }
 
@@ -196,5 +228,132 @@ TraceForwardingStrategy::Pull(const Face& inFace, const Interest& interest, cons
 
 }
 
+void
+TraceForwardingStrategy::sendInterestTo(const shared_ptr<pit::Entry>& pitEntry, Face& outFace, const Interest& interest)
+{
+  if (outFace.getLinkType() != ndn::nfd::LINK_TYPE_MULTI_ACCESS) {
+    this->sendInterest(pitEntry, outFace, interest);
+    return;
+  }
+
+  overhear(outFace);
+
+  FaceId faceId = outFace.getId();
+  InterestKey key(interest.getName(), interest.getNonce());
+  if (isDuplicate(faceId, key)) {
+    ++m_nDuplicateSuppressed;
+    NFD_LOG_INFO("NFD: Already on the medium, not sending: " << interest.getName() << " to Face: " << outFace);
+    return;
+  }
+
+  TransmissionKey transmissionKey(faceId, key);
+  if (m_deferredTransmissions.count(transmissionKey) > 0) {
+    return;
+  }
+
+  boost::random::uniform_int_distribution<time::nanoseconds::rep> dist(0, s_wirelessMaxDeferral.count());
+  time::nanoseconds delay(dist(getGlobalRng()));
+
+  weak_ptr<pit::Entry> weakPitEntry = pitEntry;
+  shared_ptr<Interest> deferred = make_shared<Interest>(interest);
+  m_deferredTransmissions[transmissionKey] = scheduler::schedule(delay,
+    [this, weakPitEntry, deferred, transmissionKey] {
+      m_deferredTransmissions.erase(transmissionKey);
+
+      shared_ptr<pit::Entry> pitEntry = weakPitEntry.lock();
+      Face* face = this->getFace(transmissionKey.first);
+      if (pitEntry == nullptr || face == nullptr) {
+        return;
+      }
+      rememberInterest(transmissionKey.first, transmissionKey.second);
+      this->sendInterest(pitEntry, *face, *deferred);
+    });
+  ++m_nDeferred;
+}
+
+void
+TraceForwardingStrategy::overhear(Face& face)
+{
+  if (m_overhearConnections.count(face.getId()) > 0) {
+    return;
+  }
+
+  FaceId faceId = face.getId();
+  m_overhearConnections[faceId] = face.afterReceiveInterest.connect(
+    [this, faceId] (const Interest& interest) { this->onOverheardInterest(faceId, interest); });
+}
+
+void
+TraceForwardingStrategy::onOverheardInterest(FaceId faceId, const Interest& interest)
+{
+  InterestKey key(interest.getName(), interest.getNonce());
+  rememberInterest(faceId, key);
+
+  auto it = m_deferredTransmissions.find(TransmissionKey(faceId, key));
+  if (it != m_deferredTransmissions.end()) {
+    scheduler::cancel(it->second);
+    m_deferredTransmissions.erase(it);
+    ++m_nOverhearSuppressed;
+    NFD_LOG_INFO("NFD: Overheard " << interest.getName() << " on Face: " << faceId << ", cancelling own transmission");
+  }
+}
+
+template<typename Cache>
+static void
+purgeDuplicateCache(Cache& cache, const time::nanoseconds& lifetime)
+{
+  auto expiry = time::steady_clock::now() - lifetime;
+  while (!cache.queue.empty() && cache.queue.front().first < expiry) {
+    cache.keys.erase(cache.queue.front().second);
+    cache.queue.pop_front();
+  }
+}
+
+bool
+TraceForwardingStrategy::isDuplicate(FaceId faceId, const InterestKey& key)
+{
+  auto cacheIt = m_duplicateCaches.find(faceId);
+  if (cacheIt == m_duplicateCaches.end()) {
+    return false;
+  }
+
+  purgeDuplicateCache(cacheIt->second, s_duplicateCacheLifetime);
+  return cacheIt->second.keys.count(key) > 0;
+}
+
+void
+TraceForwardingStrategy::rememberInterest(FaceId faceId, const InterestKey& key)
+{
+  DuplicateCache& cache = m_duplicateCaches[faceId];
+  purgeDuplicateCache(cache, s_duplicateCacheLifetime);
+  if (cache.keys.insert(key).second) {
+    cache.queue.emplace_back(time::steady_clock::now(), key);
+  }
+}
+
+void
+TraceForwardingStrategy::countTrace()
+{
+  ++m_nTraces;
+
+  time::nanoseconds now = time::duration_cast<time::nanoseconds>(time::steady_clock::now().time_since_epoch());
+  int64_t window = now.count() / s_traceBurstWindow.count();
+  if (window != m_traceWindow) {
+    m_traceWindow = window;
+    m_nTracesInWindow = 0;
+  }
+
+  // move the current window up one bucket, so the histogram is always up to date
+  if (m_nTracesInWindow > 0) {
+    auto it = m_tracesPerWindow.find(m_nTracesInWindow);
+    if (--it->second == 0) {
+      m_tracesPerWindow.erase(it);
+    }
+  }
+  ++m_nTracesInWindow;
+  ++m_tracesPerWindow[m_nTracesInWindow];
+  m_maxTracesPerWindow = std::max(m_maxTracesPerWindow, m_nTracesInWindow);
+}
+
 } // namespace fw
 } // namespace nfd
\ No newline at end of file
@@ -16,6 +16,8 @@
 #include "tt.h" // wanted to name it Trace Information Table, but...
 #include "itt.h"
 
+#include <deque>
+
 namespace nfd {
 namespace fw {
 
@@ -40,6 +42,16 @@ public:
   bool Pull(const Face& inFace, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry);
 
 protected:
+  /** \brief sends Interest, with broadcast-storm suppression on multi-access faces
+   *
+   *  On a multi-access (shared wireless) face the transmission is deferred by a random time.
+   *  It is cancelled if the same Interest (name and nonce) is overheard on that face in the meantime,
+   *  and skipped if it was already heard or sent there recently (per-face duplicate cache).
+   *  Other faces are sent to directly.
+   */
+  void
+  sendInterestTo(const shared_ptr<pit::Entry>& pitEntry, Face& outFace, const Interest& interest);
+
 
   const shared_ptr<trace::Entry>
   matchTraceEntry(const shared_ptr<pit::Entry>& pitEntry, uint32_t flag = 0)
@@ -54,6 +66,12 @@ protected:
     if (traceEntry == nullptr) {
       return;
     }
+    // a refreshed entry is bound to the PIT entry of the newest trace,
+    // only that one takes the trace entry with it when it expires
+    if (traceEntry->getPitEntry() != pitEntry) {
+      traceEntry->eraseMember(pitEntry->getInterest().getTraceName(), pitEntry);
+      return;
+    }
     m_tt.erase(traceEntry.get());
   }
 
@@ -86,12 +104,161 @@ protected:
     return m_itt.find(pitEntry->getInterest());
   }
 
+public:
+  /** \brief sets the trace aggregation prefix length of strategy instances created afterwards
+   *  \sa trace::Tt::setAggregationPrefixLength
+   */
+  static void
+  setTraceAggregationPrefixLength(size_t prefixLength)
+  {
+    s_traceAggregationPrefixLength = prefixLength;
+  }
+
+  /** \brief sets the maximum random deferral before sending on a multi-access face
+   */
+  static void
+  setWirelessMaxDeferral(const time::nanoseconds& maxDeferral)
+  {
+    s_wirelessMaxDeferral = maxDeferral;
+  }
+
+  /** \brief sets how long an Interest heard or sent on a multi-access face is remembered
+   */
+  static void
+  setDuplicateCacheLifetime(const time::nanoseconds& lifetime)
+  {
+    s_duplicateCacheLifetime = lifetime;
+  }
+
+  /** \brief sets the window over which trace bursts are measured
+   */
+  static void
+  setTraceBurstWindow(const time::nanoseconds& window)
+  {
+    s_traceBurstWindow = window;
+  }
+
+public: // wireless counters
+  /** \return number of Interests deferred on multi-access faces
+   */
+  uint64_t
+  getDeferredCount() const
+  {
+    return m_nDeferred;
+  }
+
+  /** \return number of deferred Interests cancelled because a neighbour sent them first
+   */
+  uint64_t
+  getOverhearSuppressedCount() const
+  {
+    return m_nOverhearSuppressed;
+  }
+
+  /** \return number of Interests not sent because they were already on the medium
+   */
+  uint64_t
+  getDuplicateSuppressedCount() const
+  {
+    return m_nDuplicateSuppressed;
+  }
+
+public: // trace burstiness
+  /** \return number of traces (flag 1 Interests) received
+   */
+  uint64_t
+  getTraceCount() const
+  {
+    return m_nTraces;
+  }
+
+  /** \return the largest number of traces received within one burst window
+   */
+  uint32_t
+  getMaxTracesPerWindow() const
+  {
+    return m_maxTracesPerWindow;
+  }
+
+  /** \return for every number of traces, how many burst windows received that many (empty windows left out)
+   */
+  const std::map<uint32_t, uint64_t>&
+  getTracesPerWindowHistogram() const
+  {
+    return m_tracesPerWindow;
+  }
+
+public: // tables
+  const trace::Tt&
+  getTt() const
+  {
+    return m_tt;
+  }
+
+  const itrace::Itt&
+  getItt() const
+  {
+    return m_itt;
+  }
+
 public:
   static const Name STRATEGY_NAME;
 
+private: // wireless
+  typedef std::pair<Name, uint32_t> InterestKey; // name and nonce
+  typedef std::pair<FaceId, InterestKey> TransmissionKey;
+
+  /** \brief Interests recently heard or sent on one multi-access face
+   */
+  struct DuplicateCache
+  {
+    std::set<InterestKey> keys;
+    std::deque<std::pair<time::steady_clock::TimePoint, InterestKey>> queue; // in insertion order
+  };
+
+  /** \brief subscribes to all Interests received on a multi-access face, including duplicates
+   */
+  void
+  overhear(Face& face);
+
+  void
+  onOverheardInterest(FaceId faceId, const Interest& interest);
+
+  /** \return whether the Interest was heard or sent on the face within the cache lifetime
+   */
+  bool
+  isDuplicate(FaceId faceId, const InterestKey& key);
+
+  void
+  rememberInterest(FaceId faceId, const InterestKey& key);
+
+private:
+  /** \brief accounts a received trace to the current burst window
+   */
+  void
+  countTrace();
+
 private:
+  static size_t s_traceAggregationPrefixLength;
+  static time::nanoseconds s_wirelessMaxDeferral;
+  static time::nanoseconds s_duplicateCacheLifetime;
+  static time::nanoseconds s_traceBurstWindow;
+
   trace::Tt m_tt;
   itrace::Itt m_itt;
+
+  std::map<TransmissionKey, scheduler::EventId> m_deferredTransmissions;
+  std::map<FaceId, DuplicateCache> m_duplicateCaches;
+  std::map<FaceId, signal::ScopedConnection> m_overhearConnections;
+  uint64_t m_nDeferred;
+  uint64_t m_nOverhearSuppressed;
+  uint64_t m_nDuplicateSuppressed;
+
+  int64_t m_traceWindow; // index of the current burst window
+  uint32_t m_nTracesInWindow;
+  uint32_t m_maxTracesPerWindow;
+  std::map<uint32_t, uint64_t> m_tracesPerWindow;
+  uint64_t m_nTraces;
 };
 
 } // namespace fw
@@ -13,57 +13,74 @@ namespace nfd {
 namespace trace {
 
 Tt::Tt()
+  : m_aggregationPrefixLength(0)
+  , m_nInserts(0)
+  , m_nRefreshes(0)
+  , m_nAggregated(0)
 {
 }
 
+shared_ptr<Entry>
+Tt::findAggregate(const Name& name) const
+{
+  if (!isAggregated(name)) {
+    return nullptr;
+  }
+
+  auto it = m_aggregates.find(name.getPrefix(m_aggregationPrefixLength));
+  if (it != m_aggregates.end()) {
+    return it->second;
+  }
+  return nullptr;
+}
+
 shared_ptr<Entry>
 Tt::match(const Interest& interest, uint32_t flag) const
 {
-  // check if trace entry already exists
-  auto it = std::find_if(m_entries.begin(), m_entries.end(),
-    [&interest, flag] (const shared_ptr<Entry>& entry) {
-      // initial part of name is guaranteed to be equal by NameTree
-      // check implicit digest (or its absence) only
-      return entry->matchesInterest(interest, flag);
-    });
+  // flag 0: the entry pulled by this Interest has traceName == interest.name
+  // otherwise: the entry has traceName == interest.traceName
+  if (flag != 0 && !interest.hasTraceName()) {
+    return nullptr;
+  }
+  const Name& key = (flag == 0) ? interest.getName() : interest.getTraceName();
 
+  auto it = m_entries.find(key);
   if (it != m_entries.end()) {
-    NFD_LOG_INFO("TT: Match found on TraceName: " << (*it)->getInterest().getTraceName());
-    return *it;
+    NFD_LOG_INFO("TT: Match found on TraceName: " << it->second->getInterest().getTraceName());
+    return it->second;
   }
-  else {
-    return nullptr;
+
+  shared_ptr<Entry> aggregate = findAggregate(key);
+  if (aggregate != nullptr) {
+    NFD_LOG_INFO("TT: Match found on prefix entry for: " << key);
   }
+  return aggregate;
 }
 
 shared_ptr<Entry>
 Tt::find(const Interest& interest) const
 {
   BOOST_ASSERT(interest.hasTraceName());
-  // check if trace entry already exists
-  auto it = std::find_if(m_entries.begin(), m_entries.end(),
-    [&interest] (const shared_ptr<Entry>& entry) {
-      // initial part of name is guaranteed to be equal by NameTree
-      // check implicit digest (or its absence) only
-      return entry->isEqual(interest);
-    });
 
+  auto it = m_entries.find(interest.getTraceName());
   if (it != m_entries.end()) {
-    NFD_LOG_INFO("TT: Found entry with TraceName: " << (*it)->getInterest().getTraceName());
-    return *it;
+    NFD_LOG_INFO("TT: Found entry with TraceName: " << it->second->getInterest().getTraceName());
+    return it->second;
   }
-  else {
-    return nullptr;
-  }
-}
 
+  return findAggregate(interest.getTraceName());
+}
 
 std::pair<shared_ptr<Entry>, bool>
 Tt::insert(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry)
 {
   BOOST_ASSERT(interest.hasTraceName());
 
-  shared_ptr<Entry> entry= find(interest);
+  if (isAggregated(interest.getTraceName())) {
+    return insertAggregated(face, interest, pitEntry);
+  }
+
+  shared_ptr<Entry> entry = refresh(face, interest, pitEntry);
   if (entry != nullptr) {
     return {entry, false};
   }
@@ -73,25 +90,93 @@ Tt::insert(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& p
   entry = shared_ptr<Entry>(new Entry(face, interest, pitEntry));
   NFD_LOG_INFO("TT: Entry created with TraceName: " << entry->getInterest().getTraceName());
 
-  m_entries.push_back(entry);
+  m_entries.emplace(interest.getTraceName(), entry);
+  ++m_nInserts;
+  return {entry, true};
+}
+
+std::pair<shared_ptr<Entry>, bool>
+Tt::insertAggregated(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry)
+{
+  const Name& traceName = interest.getTraceName();
+  Name prefix = traceName.getPrefix(m_aggregationPrefixLength);
+
+  auto aggIt = m_aggregates.find(prefix);
+  if (aggIt == m_aggregates.end()) {
+    auto entry = shared_ptr<Entry>(new Entry(face, interest, pitEntry));
+    NFD_LOG_INFO("TT: Prefix entry created for: " << prefix << " by TraceName: " << traceName);
+    entry->setMember(interest, pitEntry);
+    m_aggregates.emplace(prefix, entry);
+    m_entries.erase(traceName); // an exception left over from an earlier prefix entry
+    ++m_nInserts;
+    return {entry, true};
+  }
+
+  const shared_ptr<Entry>& aggregate = aggIt->second;
+  if (aggregate->getFace().getId() == face.getId()) {
+    // back behind the common face, the exception is no longer needed
+    auto it = m_entries.find(traceName);
+    if (it != m_entries.end()) {
+      NFD_LOG_INFO("TT: Dropping exception for TraceName: " << traceName);
+      m_entries.erase(it);
+    }
+    aggregate->refresh(face, interest, pitEntry);
+    aggregate->setMember(interest, pitEntry);
+    ++m_nAggregated;
+    return {aggregate, false};
+  }
+
+  // different face, keep an exception, the prefix entry no longer leads to this mobile
+  aggregate->eraseMember(traceName);
+  auto it = m_entries.find(traceName);
+  if (it != m_entries.end()) {
+    it->second->refresh(face, interest, pitEntry);
+    ++m_nRefreshes;
+    return {it->second, false};
+  }
+
+  auto entry = shared_ptr<Entry>(new Entry(face, interest, pitEntry));
+  NFD_LOG_INFO("TT: Exception created under prefix: " << prefix << " for TraceName: " << traceName);
+  m_entries.emplace(traceName, entry);
+  ++m_nInserts;
   return {entry, true};
 }
 
+shared_ptr<Entry>
+Tt::refresh(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry)
+{
+  BOOST_ASSERT(interest.hasTraceName());
+
+  auto it = m_entries.find(interest.getTraceName());
+  if (it == m_entries.end()) {
+    return nullptr;
+  }
+
+  it->second->refresh(face, interest, pitEntry);
+  ++m_nRefreshes;
+  NFD_LOG_INFO("TT: Refreshed entry with TraceName: " << interest.getTraceName() << ", face: " << face.getId());
+  return it->second;
+}
+
 void
 Tt::erase(Entry* entry)
 {
-  auto it = std::find_if(m_entries.begin(), m_entries.end(),
-    [entry] (const shared_ptr<Entry>& t_entry) {
-      // initial part of name is guaranteed to be equal by NameTree
-      // check implicit digest (or its absence) only
-      return (t_entry.get() == entry);
-    });
-  if (it != m_entries.end()) {
-    if (*it != nullptr) {
-      NFD_LOG_INFO("TT: Erasing entry with TraceName: " << (*it)->getTraceName());
-      (*it).reset(); // right?
-    }
+  const Name& traceName = entry->getTraceName();
+
+  auto it = m_entries.find(traceName);
+  // the entry may already have been replaced under the same traceName
+  if (it != m_entries.end() && it->second.get() == entry) {
+    NFD_LOG_INFO("TT: Erasing entry with TraceName: " << it->first);
     m_entries.erase(it);
+    return;
+  }
+
+  if (isAggregated(traceName)) {
+    auto aggIt = m_aggregates.find(traceName.getPrefix(m_aggregationPrefixLength));
+    if (aggIt != m_aggregates.end() && aggIt->second.get() == entry) {
+      NFD_LOG_INFO("TT: Erasing prefix entry: " << aggIt->first);
+      m_aggregates.erase(aggIt);
+    }
   }
 }
 
@@ -10,29 +10,63 @@
 
 #include "trace-entry.h"
 
+#include <unordered_map>
+#include <boost/functional/hash.hpp>
+
 namespace nfd {
 namespace trace {
 
-typedef std::vector<shared_ptr<Entry>>::const_iterator Iterator;
+/** \brief hashes a trace name component by component
+ */
+struct TraceNameHash
+{
+  size_t
+  operator()(const Name& name) const
+  {
+    size_t seed = 0;
+    for (const name::Component& component : name) {
+      boost::hash_combine(seed, boost::hash_range(component.value_begin(), component.value_end()));
+    }
+    return seed;
+  }
+};
+
+typedef std::unordered_map<Name, shared_ptr<Entry>, TraceNameHash> EntryTable;
+
+typedef EntryTable::const_iterator Iterator;
 
 /** \brief represents the trace Table
+ *
+ *  With aggregation enabled (see setAggregationPrefixLength), traces whose names share
+ *  a prefix of the configured length and arrive on the same face are collapsed into
+ *  one prefix entry. A trace under that prefix arriving on another face is kept as an
+ *  exact per-name entry (an exception), which takes precedence over the prefix entry
+ *  on lookup and is dropped again once the mobile is back behind the prefix entry's face.
+ *  A prefix entry keeps the newest trace of each mobile it covers as a member, so that
+ *  pulling one of them sends that mobile's own trace. Aggregation thus reduces the entries
+ *  traces are matched against, not the per-mobile state: size() counts the members too.
  */
 class Tt : noncopyable
 {
 public:
   Tt();
 
-  /** \return number of entries
+  /** \return number of entries, counting each member of a prefix entry as one
    */
   size_t
   size() const
   {
-    return m_entries.size();
+    size_t n = m_entries.size() + m_aggregates.size();
+    for (const auto& aggregate : m_aggregates) {
+      n += aggregate.second->getMemberCount();
+    }
+    return n;
   }
 
   /** \brief matches a trace entry for Interest
    *  \param interest the Interest
-   *  \return an existing entry whose traceName equals the Interest's name
+   *  \return an existing entry whose traceName equals the Interest's name,
+   *          or the prefix entry covering it, see Entry::findMember
    */
   shared_ptr<Entry>
   match(const Interest& interest, uint32_t flag = 0) const;
@@ -48,20 +82,78 @@ public:
    *  \param interest the Interest; must be created with make_shared
    *  \return a new or existing entry with same traceName,
    *          and true for new entry, false for existing entry
+   *  \note an existing entry is refreshed in place, see refresh()
    */
   std::pair<shared_ptr<Entry>, bool>
   insert(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry);
 
+  /** \brief refreshes the existing trace entry for Interest in place
+   *  \param interest the Interest; must be created with make_shared
+   *  \return the refreshed entry, or nullptr if no entry has the same traceName
+   */
+  shared_ptr<Entry>
+  refresh(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry);
+
   /** \brief deletes an entry
    */
   void
   erase(Entry* entry);  // why bare pointer here?
 
+public: // aggregation
+  /** \brief sets the number of leading traceName components shared by aggregated entries
+   *  \param prefixLength prefix length, 0 disables aggregation
+   *  \note only affects traces inserted afterwards
+   */
+  void
+  setAggregationPrefixLength(size_t prefixLength)
+  {
+    m_aggregationPrefixLength = prefixLength;
+  }
+
+  size_t
+  getAggregationPrefixLength() const
+  {
+    return m_aggregationPrefixLength;
+  }
+
+  /** \return number of prefix entries
+   */
+  size_t
+  getAggregateCount() const
+  {
+    return m_aggregates.size();
+  }
+
+public: // counters
+  /** \return number of entries created since construction
+   */
+  uint64_t
+  getInsertCount() const
+  {
+    return m_nInserts;
+  }
+
+  /** \return number of in-place refreshes of existing entries since construction
+   */
+  uint64_t
+  getRefreshCount() const
+  {
+    return m_nRefreshes;
+  }
+
+  /** \return number of traces absorbed by a prefix entry since construction
+   */
+  uint64_t
+  getAggregatedCount() const
+  {
+    return m_nAggregated;
+  }
+
 public: // enumeration
   typedef Iterator const_iterator;
 
   /** \return an iterator to the beginning
-   *  \note Iteration order is implementation-defined.
+   *  \note Iteration order is implementation-defined. Prefix entries are not enumerated.
    *  \warning Undefined behavior may occur if a FIB/PIT/Measurements/StrategyChoice entry
    *           is inserted or erased during enumeration.
    */
@@ -75,7 +167,29 @@ public: // enumeration
   end() const;
 
 private:
-  std::vector<shared_ptr<Entry>> m_entries;
+  /** \return whether traces under \p name are aggregated
+   */
+  bool
+  isAggregated(const Name& name) const
+  {
+    return m_aggregationPrefixLength > 0 && name.size() > m_aggregationPrefixLength;
+  }
+
+  /** \return the prefix entry covering \p name, or nullptr
+   */
+  shared_ptr<Entry>
+  findAggregate(const Name& name) const;
+
+  std::pair<shared_ptr<Entry>, bool>
+  insertAggregated(Face& face, const Interest& interest, const shared_ptr<pit::Entry>& pitEntry);
+
+private:
+  EntryTable m_entries; // keyed by traceName
+  EntryTable m_aggregates; // keyed by traceName prefix
+  size_t m_aggregationPrefixLength;
+  uint64_t m_nInserts;
+  uint64_t m_nRefreshes;
+  uint64_t m_nAggregated;
 };
 
 } // namespace trace
@@ -1,102 +1,225 @@
 #!/usr/bin/env python
 # -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
 
-from subprocess import call
-from sys import argv
+"""Runs parameter sweeps of the scenarios in parallel and aggregates their metrics.
+
+A sweep is described by a JSON file:
+
+    {
+        "name": "upload-speed",
+        "scenario": "my-upload",
+        "runs": 5,
+        "parameters": {"speed": [5, 10, 20], "size": [10, 100]},
+        "fixed": {"stop": 60, "wireless": "range"}
+    }
+
+Every combination of "parameters" is run "runs" times, with --RngRun set to the run number and
+the "fixed" options added. Each run gets results/<name>/<point>/run-<n>/, holding the output of
+the scenario (log.txt) and its --metrics file (metrics.json). A run is done once metrics.json
+exists, so an interrupted sweep resumes where it stopped when started again.
+
+The metrics of all runs are then gathered in results/<name>/runs.csv, and averaged over the runs
+of each point in results/<name>/summary.csv.
+
+    ./waf
+    ./run.py sweeps/upload-speed.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import collections
+import csv
+import itertools
+import json
+import math
+import multiprocessing
 import os
+import signal
 import subprocess
-import workerpool
-import multiprocessing
-import argparse
+import sys
 
 ######################################################################
 ######################################################################
 ######################################################################
 
-parser = argparse.ArgumentParser(description='Simulation runner')
-parser.add_argument('scenarios', metavar='scenario', type=str, nargs='*',
-                    help='Scenario to run')
+parser = argparse.ArgumentParser(description='Parallel simulation sweep runner')
+parser.add_argument('sweeps', metavar='sweep', type=str, nargs='+',
+                    help='JSON sweep specification')
+
+parser.add_argument('-j', '--jobs', dest='jobs', type=int, default=multiprocessing.cpu_count(),
+                    help='Number of runs at the same time (all cores by default)')
+
+parser.add_argument('-a', '--aggregate-only', dest='aggregate_only', action='store_true', default=False,
+                    help='Only aggregate the metrics of finished runs')
 
-parser.add_argument('-l', '--list', dest="list", action='store_true', default=False,
-                    help='Get list of available scenarios')
+parser.add_argument('-n', '--dry-run', dest='dry_run', action='store_true', default=False,
+                    help='Print the runs that would be started')
 
-parser.add_argument('-s', '--simulate', dest="simulate", action='store_true', default=False,
-                    help='Run simulation and postprocessing (false by default)')
+parser.add_argument('-g', '--graph', dest='graph', action='store_true', default=False,
+                    help='Run graphs/<name>.R after aggregation')
 
-parser.add_argument('-g', '--no-graph', dest="graph", action='store_false', default=True,
-                    help='Do not build a graph for the scenario (builds a graph by default)')
+parser.add_argument('-o', '--output', dest='output', type=str, default='results',
+                    help='Directory holding the sweep results (results by default)')
 
 args = parser.parse_args()
 
-if not args.list and len(args.scenarios)==0:
-    print "ERROR: at least one scenario need to be specified"
-    parser.print_help()
-    exit (1)
+######################################################################
+######################################################################
+######################################################################
+
+def load_sweep(path):
+    with open(path) as f:
+        sweep = json.load(f, object_pairs_hook=collections.OrderedDict)
+    for key in ('name', 'scenario', 'parameters'):
+        if key not in sweep:
+            sys.exit('ERROR: %s: missing "%s"' % (path, key))
+    sweep.setdefault('runs', 1)
+    sweep.setdefault('fixed', collections.OrderedDict())
+    return sweep
+
+def point_name(point):
+    return ','.join('%s=%s' % (key, value) for key, value in point.items()) or 'default'
+
+def expand(sweep):
+    """All runs of a sweep, as (point, run number, run directory, command line)"""
+    binary = os.path.join('build', sweep['scenario'])
+    names = list(sweep['parameters'].keys())
+    values = [v if isinstance(v, list) else [v] for v in sweep['parameters'].values()]
+    for combination in itertools.product(*values):
+        point = collections.OrderedDict(zip(names, combination))
+        for run in range(1, sweep['runs'] + 1):
+            directory = os.path.join(args.output, sweep['name'], point_name(point), 'run-%d' % run)
+            cmdline = [binary]
+            for key, value in itertools.chain(sweep['fixed'].items(), point.items()):
+                cmdline.append('--%s=%s' % (key, value))
+            cmdline.append('--RngRun=%d' % run)
+            cmdline.append('--metrics=%s' % os.path.join(directory, 'metrics.json'))
+            yield point, run, directory, cmdline
+
+def is_done(directory):
+    return os.path.exists(os.path.join(directory, 'metrics.json'))
+
+def simulate(job):
+    directory, cmdline = job
+    if not os.path.isdir(directory):
+        os.makedirs(directory)
+    with open(os.path.join(directory, 'log.txt'), 'w') as log:
+        log.write(' '.join(cmdline) + '\n')
+        log.flush()
+        code = subprocess.call(cmdline, stdout=log, stderr=subprocess.STDOUT)
+    return directory, code
+
+def ignore_sigint():
+    # Ctrl-C is handled by the parent, which terminates the pool
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+
+def run_sweep(sweep):
+    runs = list(expand(sweep))
+    pending = [(directory, cmdline) for _, _, directory, cmdline in runs if not is_done(directory)]
+    print('%s: %d runs, %d done, %d to go' % (sweep['name'], len(runs), len(runs) - len(pending), len(pending)))
+
+    if args.dry_run:
+        for _, cmdline in pending:
+            print('    ' + ' '.join(cmdline))
+        return True
+    if not pending:
+        return True
+
+    binary = os.path.join('build', sweep['scenario'])
+    if not os.path.exists(binary):
+        sys.exit('ERROR: %s does not exist, build it with ./waf first' % binary)
+
+    failed = []
+    pool = multiprocessing.Pool(processes=args.jobs, initializer=ignore_sigint)
+    try:
+        # a timeout keeps the wait interruptible by Ctrl-C
+        results = pool.imap_unordered(simulate, pending)
+        for done in range(1, len(pending) + 1):
+            directory, code = results.next(timeout=365 * 24 * 3600)
+            status = 'ok' if code == 0 and is_done(directory) else 'FAILED (%d)' % code
+            if status != 'ok':
+                failed.append(directory)
+            print('[%d/%d] %s %s' % (done, len(pending), directory, status))
+        pool.close()
+    except KeyboardInterrupt:
+        pool.terminate()
+        sys.exit('Interrupted, finished runs are kept and the sweep resumes from them')
+    finally:
+        pool.join()
+
+    for directory in failed:
+        print('see %s' % os.path.join(directory, 'log.txt'))
+    return not failed
 
-if args.list:
-    print "Available scenarios: "
-else:
-    if args.simulate:
-        print "Simulating the following scenarios: " + ",".join (args.scenarios)
+######################################################################
+######################################################################
+######################################################################
 
-    if args.graph:
-        print "Building graphs for the following scenarios: " + ",".join (args.scenarios)
+def mean_and_stddev(values):
+    mean = float(sum(values)) / len(values)
+    if len(values) < 2:
+        return mean, 0.0
+    return mean, math.sqrt(sum((v - mean) ** 2 for v in values) / (len(values) - 1))
+
+def aggregate(sweep):
+    rows = []
+    metric_names = []
+    for point, run, directory, _ in expand(sweep):
+        if not is_done(directory):
+            continue
+        with open(os.path.join(directory, 'metrics.json')) as f:
+            metrics = json.load(f, object_pairs_hook=collections.OrderedDict)
+        for name in metrics:
+            if name not in metric_names:
+                metric_names.append(name)
+        rows.append((point, run, metrics))
+
+    if not rows:
+        print('%s: no finished run to aggregate' % sweep['name'])
+        return
+
+    parameter_names = list(sweep['parameters'].keys())
+    directory = os.path.join(args.output, sweep['name'])
+
+    with open(os.path.join(directory, 'runs.csv'), 'w') as f:
+        writer = csv.writer(f)
+        writer.writerow(parameter_names + ['run'] + metric_names)
+        for point, run, metrics in rows:
+            writer.writerow(list(point.values()) + [run] + [metrics.get(name, '') for name in metric_names])
+
+    points = collections.OrderedDict()
+    for point, run, metrics in rows:
+        points.setdefault(tuple(point.values()), []).append(metrics)
+
+    with open(os.path.join(directory, 'summary.csv'), 'w') as f:
+        writer = csv.writer(f)
+        header = parameter_names + ['runs']
+        for name in metric_names:
+            header += [name, name + '.sd']
+        writer.writerow(header)
+        for values, runs in points.items():
+            row = list(values) + [len(runs)]
+            for name in metric_names:
+                numbers = [m[name] for m in runs if isinstance(m.get(name), (int, float))]
+                row += list(mean_and_stddev(numbers)) if numbers else ['', '']
+            writer.writerow(row)
+
+    print('%s: %d runs aggregated into %s' % (sweep['name'], len(rows), os.path.join(directory, 'summary.csv')))
+
+    if args.graph and os.path.exists(os.path.join('graphs', sweep['name'] + '.R')):
+        subprocess.call(['./graphs/%s.R' % sweep['name']])
 
 ######################################################################
 ######################################################################
 ######################################################################
 
-class SimulationJob (workerpool.Job):
-    "Job to simulate things"
-    def __init__ (self, cmdline):
-        self.cmdline = cmdline
-    def run (self):
-        print (" ".join (self.cmdline))
-        subprocess.call (self.cmdline)
-
-pool = workerpool.WorkerPool(size = multiprocessing.cpu_count())
-
-class Processor:
-    def run (self):
-        if args.list:
-            print "    " + self.name
-            return
-
-        if "all" not in args.scenarios and self.name not in args.scenarios:
-            return
-
-        if args.list:
-            pass
-        else:
-            if args.simulate:
-                self.simulate ()
-                pool.join ()
-                self.postprocess ()
-            if args.graph:
-                self.graph ()
-
-    def graph (self):
-        subprocess.call ("./graphs/%s.R" % self.name, shell=True)
-
-class Scenario (Processor):
-    def __init__ (self, name):
-        self.name = name
-        # other initialization, if any
-
-    def simulate (self):
-        cmdline = ["./build/SCENARIO_TO_RUN"]
-        job = SimulationJob (cmdline)
-        pool.put (job)
-
-    def postprocess (self):
-        # any postprocessing, if any
-        pass
-
-try:
-    # Simulation, processing, and graph building
-    fig = Scenario (name="NAME_TO_CONFIGURE")
-    fig.run ()
-
-finally:
-    pool.join ()
-    pool.shutdown ()
+if __name__ == '__main__':
+    ok = True
+    for path in args.sweeps:
+        sweep = load_sweep(path)
+        if not args.aggregate_only:
+            ok = run_sweep(sweep) and ok
+        if not args.dry_run:
+            aggregate(sweep)
+    sys.exit(0 if ok else 1)
@@ -0,0 +1,200 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+// kite-aggregation-test.cc
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ndnSIM-module.h"
+
+#include "trace-forwarding.h"
+
+#include <iostream>
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * @brief Sends traces on request and records the TraceNames of the traces it receives
+ */
+class KiteTraceProbe : public App {
+public:
+  static TypeId
+  GetTypeId()
+  {
+    static TypeId tid = TypeId("ns3::ndn::KiteTraceProbe")
+                          .SetGroupName("Ndn")
+                          .SetParent<App>()
+                          .AddConstructor<KiteTraceProbe>();
+    return tid;
+  }
+
+  /**
+   * @brief Receives the Interests under @p prefix
+   */
+  void
+  Listen(const Name& prefix)
+  {
+    m_prefix = prefix;
+  }
+
+  /**
+   * @brief Sends a flag-1 Interest named @p name with TraceName @p traceName at @p at
+   */
+  void
+  SendTrace(Time at, const Name& name, const Name& traceName)
+  {
+    Simulator::Schedule(at, &KiteTraceProbe::DoSendTrace, this, name, traceName);
+  }
+
+  const std::vector<Name>&
+  GetReceivedTraceNames() const
+  {
+    return m_received;
+  }
+
+protected:
+  virtual void
+  StartApplication() override
+  {
+    App::StartApplication();
+    if (!m_prefix.empty()) {
+      FibHelper::AddRoute(GetNode(), m_prefix, m_face, 0);
+    }
+  }
+
+  virtual void
+  OnInterest(shared_ptr<const Interest> interest) override
+  {
+    App::OnInterest(interest);
+    m_received.push_back(interest->getTraceName());
+  }
+
+private:
+  void
+  DoSendTrace(Name name, Name traceName)
+  {
+    shared_ptr<Interest> interest = make_shared<Interest>(name);
+    interest->setTraceName(traceName);
+    interest->setTraceFlag(1);
+    interest->setInterestLifetime(time::seconds(10));
+
+    m_transmittedInterests(interest, this, m_face);
+    m_appLink->onReceiveInterest(*interest);
+  }
+
+private:
+  Name m_prefix;
+  std::vector<Name> m_received;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(KiteTraceProbe);
+
+} // namespace ndn
+
+/**
+ * Two mobiles under /mobile reach the core router through the same access router,
+ * so with an aggregation prefix length of 1 the core router keeps a single /mobile
+ * entry for both:
+ *
+ *      mobile a --+
+ *                 +-- access -- core -- server
+ *      mobile b --+               |
+ *                               puller
+ *
+ * b traces first and a second, so a's trace is the newest one under /mobile. The puller
+ * then pulls /mobile/b through the core router and must get b's trace, not a's.
+ *
+ *     ./waf --run=kite-aggregation-test
+ */
+
+int
+main(int argc, char* argv[])
+{
+  Config::SetDefault("ns3::PointToPointNetDevice::DataRate", StringValue("1Mbps"));
+  Config::SetDefault("ns3::PointToPointChannel::Delay", StringValue("10ms"));
+
+  CommandLine cmd;
+  cmd.Parse(argc, argv);
+
+  NodeContainer nodes;
+  nodes.Create(6);
+  Ptr<Node> mobileA = nodes.Get(0);
+  Ptr<Node> mobileB = nodes.Get(1);
+  Ptr<Node> access = nodes.Get(2);
+  Ptr<Node> core = nodes.Get(3);
+  Ptr<Node> server = nodes.Get(4);
+  Ptr<Node> puller = nodes.Get(5);
+
+  PointToPointHelper p2p;
+  p2p.Install(mobileA, access);
+  p2p.Install(mobileB, access);
+  p2p.Install(access, core);
+  p2p.Install(core, server);
+  p2p.Install(puller, core);
+
+  ndn::StackHelper ndnHelper;
+  ndnHelper.SetDefaultRoutes(false);
+  ndnHelper.InstallAll();
+
+  nfd::fw::TraceForwardingStrategy::setTraceAggregationPrefixLength(1);
+  ndn::StrategyChoiceHelper::InstallAll<nfd::fw::TraceForwardingStrategy>("/");
+
+  ndn::FibHelper::AddRoute(mobileA, "/server", access, 1);
+  ndn::FibHelper::AddRoute(mobileB, "/server", access, 1);
+  ndn::FibHelper::AddRoute(access, "/server", core, 1);
+  ndn::FibHelper::AddRoute(core, "/server", server, 1);
+  ndn::FibHelper::AddRoute(puller, "/mobile", core, 1);
+
+  Ptr<ndn::KiteTraceProbe> probeA = CreateObject<ndn::KiteTraceProbe>();
+  mobileA->AddApplication(probeA);
+  Ptr<ndn::KiteTraceProbe> probeB = CreateObject<ndn::KiteTraceProbe>();
+  mobileB->AddApplication(probeB);
+  Ptr<ndn::KiteTraceProbe> serverProbe = CreateObject<ndn::KiteTraceProbe>();
+  serverProbe->Listen("/server"); // keeps the traces pending instead of rejected at the core router
+  server->AddApplication(serverProbe);
+  Ptr<ndn::KiteTraceProbe> pullerProbe = CreateObject<ndn::KiteTraceProbe>();
+  pullerProbe->Listen("/server");
+  puller->AddApplication(pullerProbe);
+
+  probeB->SendTrace(Seconds(0.1), "/server/mobile/b", "/mobile/b");
+  probeA->SendTrace(Seconds(0.2), "/server/mobile/a", "/mobile/a");
+  pullerProbe->SendTrace(Seconds(1.0), "/mobile/b", "/puller");
+
+  Simulator::Stop(Seconds(2.0));
+  Simulator::Run();
+
+  auto strategy = dynamic_cast<nfd::fw::TraceForwardingStrategy*>(
+    &core->GetObject<ndn::L3Protocol>()->getForwarder()->getStrategyChoice().findEffectiveStrategy("/"));
+  size_t nAggregates = strategy->getTt().getAggregateCount();
+  size_t nEntries = strategy->getTt().size();
+  std::vector<Name> pulled = pullerProbe->GetReceivedTraceNames();
+  Simulator::Destroy();
+
+  std::cout << "prefix entries at the core router: " << nAggregates << " (" << nEntries
+            << " Tt entries with their members), pulled:";
+  for (const Name& traceName : pulled) {
+    std::cout << " " << traceName;
+  }
+  std::cout << std::endl;
+
+  if (nAggregates != 1 || pulled.size() != 1 || pulled.front() != Name("/mobile/b")) {
+    std::cout << "FAIL: expected one /mobile prefix entry and b's trace pulled" << std::endl;
+    return 1;
+  }
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
+
+} // namespace ns3
+
+int
+main(int argc, char* argv[])
+{
+  return ns3::main(argc, argv);
+}
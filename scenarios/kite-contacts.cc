@@ -0,0 +1,120 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+// kite-contacts.cc
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "ndn-kite-topology.h"
+#include "ndn-kite-mobility-replayer.h"
+#include "ndn-kite-contact-timeline.h"
+
+#include <chrono>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("KiteContacts");
+
+/**
+ * Precomputes when each mobile of my-upload is in range of each access router.
+ *
+ * Only mobility is simulated: the backbone and the mobiles are placed as my-upload places them
+ * (same topology options, same run), or the mobiles replay a recorded trace. The contact file
+ * then replaces the wireless part of my-upload:
+ *
+ *     ./waf --run "kite-contacts --size=1000 --stop=600 --range=30 --out=contacts.txt"
+ *     ./waf --run "my-upload --size=1000 --stop=600 --contacts=contacts.txt --traceOnMove=1"
+ */
+
+int
+main(int argc, char* argv[])
+{
+  std::string topo = "grid";
+  int gridSize = 3;
+  int routerSize = 0;
+  int degree = 2;
+  double spacing = 40;
+  double accessDensity = 1.0;
+  std::string topoFile;
+  int mobileSize = 1;
+  int speed = 20;
+  int stopTime = 100;
+  std::string mobilityTrace;
+  double range = 30;
+  std::string out = "contacts.txt";
+
+  CommandLine cmd;
+  cmd.AddValue("topo", "backbone topology: grid, tree or rgg", topo);
+  cmd.AddValue("grid", "grid size, the backbone has grid * grid routers unless routers is set", gridSize);
+  cmd.AddValue("routers", "# routers in the backbone", routerSize);
+  cmd.AddValue("degree", "tree degree", degree);
+  cmd.AddValue("spacing", "distance between neighbouring routers in meters", spacing);
+  cmd.AddValue("access", "fraction of the routers with wifi access", accessDensity);
+  cmd.AddValue("topoFile", "load the backbone from an annotated or binary topology file", topoFile);
+  cmd.AddValue("size", "# mobile", mobileSize);
+  cmd.AddValue("speed", "mobile speed m/s", speed);
+  cmd.AddValue("stop", "stop time", stopTime);
+  cmd.AddValue("mobilityTrace", "replay an ns-2 or ns-3 mobility trace instead of random walks", mobilityTrace);
+  cmd.AddValue("range", "distance in meters within which a mobile is in contact with an access router", range);
+  cmd.AddValue("out", "contact file to write", out);
+  cmd.Parse(argc, argv);
+
+  auto start = std::chrono::steady_clock::now();
+
+  PointToPointHelper p2p;
+  ndn::KiteTopologyBuilder topology;
+  topology.SetTopology(topo);
+  topology.SetRouterCount(routerSize > 0 ? routerSize : gridSize * gridSize);
+  topology.SetTreeDegree(degree);
+  topology.SetSpacing(spacing);
+  topology.SetAccessDensity(accessDensity);
+  if (!topoFile.empty()) {
+    topology.Load(topoFile);
+  }
+  topology.Build(p2p);
+
+  NodeContainer mobileNodes;
+  mobileNodes.Create(mobileSize);
+
+  Ptr<ndn::KiteMobilityReplayer> replayer;
+  if (mobilityTrace.empty()) {
+    topology.InstallMobility(mobileNodes, speed);
+  }
+  else {
+    replayer = CreateObject<ndn::KiteMobilityReplayer>();
+    replayer->Install(mobilityTrace, mobileNodes);
+  }
+
+  ndn::KiteContactTimeline timeline;
+  timeline.SetAccessRouters(topology.GetAccessRouters(), range);
+  timeline.Record(mobileNodes);
+
+  Simulator::Stop(Seconds(stopTime));
+  Simulator::Run();
+
+  timeline.Finish(Simulator::Now());
+  timeline.Save(out);
+
+  std::cout << timeline.GetContacts().size() << " contacts of " << mobileSize << " mobiles with "
+            << topology.GetAccessRouters().GetN() << " access routers written to " << out << " in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+
+  Simulator::Destroy();
+
+  return 0;
+}
+
+} // namespace ns3
+
+int
+main(int argc, char* argv[])
+{
+  return ns3::main(argc, argv);
+}
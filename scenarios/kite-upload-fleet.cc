@@ -0,0 +1,233 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/**
+ * Copyright (c) 2017 Harbin Institute of Technology, China
+ *
+ * Author: Zhongda Xia <xiazhongda@hit.edu.cn>
+ **/
+
+// kite-upload-fleet.cc
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ndnSIM-module.h"
+
+#include "ndn-kite-upload-server.h"
+#include "ndn-kite-upload-mobile.h"
+#include "ndn-kite-metrics.h"
+
+#include "trace-forwarding.h"
+
+#include <chrono>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("KiteUploadFleet");
+
+/**
+ * Benchmark of one upload server serving a fleet of mobiles:
+ *
+ *                                   +--------+ --- mobile /mobile/0
+ *                               +-- | access | --- ...
+ *      +--------+    +------+   |   +--------+ --- mobile /mobile/<k-1>
+ *      | server | -- | core | --+   ...
+ *      +--------+    +------+   |   +--------+ --- ...
+ *                               +-- | access | --- mobile /mobile/<size-1>
+ *                                   +--------+
+ *
+ * Mobiles are attached by point-to-point links so that the run measures the server
+ * and the Kite tables rather than the wifi PHY. Every mobile uploads MaxSeq segments
+ * in its own session of the segmented KiteUploadServer.
+ *
+ *     ./waf --run "kite-upload-fleet --size=1000 --access=10 --segments=100"
+ */
+
+int
+main(int argc, char* argv[])
+{
+  Config::SetDefault("ns3::PointToPointNetDevice::DataRate", StringValue("10Mbps"));
+  Config::SetDefault("ns3::PointToPointChannel::Delay", StringValue("5ms"));
+  Config::SetDefault("ns3::DropTailQueue::MaxPackets", StringValue("100"));
+
+  int mobileSize = 1000;
+  int accessSize = 10;
+  int segments = 100;
+  int window = 4;
+  int stopTime = 60;
+  int fecK = 0;
+  int fecN = 0;
+  bool sign = false;
+  std::string payloadFile;
+  std::string randomize = "none";
+  double jitter = 0;
+  std::string metricsFile;
+
+  CommandLine cmd;
+  cmd.AddValue("size", "# mobile", mobileSize);
+  cmd.AddValue("access", "# access routers", accessSize);
+  cmd.AddValue("segments", "segments uploaded by each mobile", segments);
+  cmd.AddValue("window", "initial window of each upload session", window);
+  cmd.AddValue("stop", "stop time", stopTime);
+  cmd.AddValue("fecK", "source segments per erasure-coded group, 0 for plain segments", fecK);
+  cmd.AddValue("fecN", "coded segments per erasure-coded group", fecN);
+  cmd.AddValue("sign", "sign upload requests and verify them on the server", sign);
+  cmd.AddValue("payload", "file uploaded by every mobile, generated content if empty", payloadFile);
+  cmd.AddValue("randomize", "trace interval randomization: none, uniform, exponential", randomize);
+  cmd.AddValue("jitter", "seconds over which the first traces of the mobiles are spread", jitter);
+  cmd.AddValue("metrics", "write the results of the run to this JSON file", metricsFile);
+  cmd.Parse(argc, argv);
+
+  auto setupStart = std::chrono::steady_clock::now();
+
+  Ptr<Node> server = CreateObject<Node>();
+  Ptr<Node> core = CreateObject<Node>();
+  NodeContainer accessRouters;
+  accessRouters.Create(accessSize);
+  NodeContainer mobileNodes;
+  mobileNodes.Create(mobileSize);
+
+  PointToPointHelper p2p;
+  p2p.Install(server, core);
+  for (int i = 0; i < accessSize; ++i) {
+    p2p.Install(core, accessRouters.Get(i));
+  }
+  for (int i = 0; i < mobileSize; ++i) {
+    p2p.Install(accessRouters.Get(i % accessSize), mobileNodes.Get(i));
+  }
+
+  // mobiles send everything up their only link, routers get explicit routes only
+  ndn::StackHelper ndnHelper;
+  ndnHelper.SetDefaultRoutes(true);
+  ndnHelper.Install(mobileNodes);
+  ndnHelper.SetDefaultRoutes(false);
+  ndnHelper.Install(server);
+  ndnHelper.Install(core);
+  ndnHelper.Install(accessRouters);
+
+  ndn::StrategyChoiceHelper::Install<nfd::fw::TraceForwardingStrategy>(core, "/");
+  ndn::StrategyChoiceHelper::Install<nfd::fw::TraceForwardingStrategy>(accessRouters, "/");
+
+  // the server's tracing Interests leave through the core, which follows the traces from there
+  ndn::FibHelper::AddRoute(server, "/mobile", core, 1);
+  ndn::FibHelper::AddRoute(core, "/server", server, 1);
+  for (int i = 0; i < accessSize; ++i) {
+    ndn::FibHelper::AddRoute(accessRouters.Get(i), "/server", core, 1);
+  }
+
+  ndn::AppHelper serverHelper("ns3::ndn::KiteUploadServer");
+  serverHelper.SetPrefix("/mobile");
+  serverHelper.SetAttribute("ServerPrefix", StringValue("/server"));
+  serverHelper.SetAttribute("SegmentedUpload", BooleanValue(true));
+  serverHelper.SetAttribute("InitialWindow", UintegerValue(window));
+  serverHelper.SetAttribute("MaxSeq", IntegerValue(segments));
+  serverHelper.SetAttribute("FecK", UintegerValue(fecK));
+  serverHelper.SetAttribute("FecN", UintegerValue(fecN));
+  serverHelper.SetAttribute("VerifyRequests", BooleanValue(sign));
+  ApplicationContainer serverApps = serverHelper.Install(server);
+
+  ApplicationContainer allMobileApps;
+  for (int i = 0; i < mobileSize; ++i) {
+    std::string mobilePrefix = "/mobile/" + std::to_string(i);
+    ndn::AppHelper mobileNodeHelper("ns3::ndn::KiteUploadMobile");
+    mobileNodeHelper.SetPrefix(mobilePrefix);
+    mobileNodeHelper.SetAttribute("ServerPrefix", StringValue("/server"));
+    mobileNodeHelper.SetAttribute("MobilePrefix", StringValue(mobilePrefix));
+    mobileNodeHelper.SetAttribute("PayloadSize", StringValue("1024"));
+    mobileNodeHelper.SetAttribute("ObjectSize", UintegerValue(segments * 1024));
+    mobileNodeHelper.SetAttribute("PayloadFile", StringValue(payloadFile));
+    mobileNodeHelper.SetAttribute("Randomize", StringValue(randomize));
+    mobileNodeHelper.SetAttribute("StartJitter", TimeValue(Seconds(jitter)));
+    mobileNodeHelper.SetAttribute("FecK", UintegerValue(fecK));
+    mobileNodeHelper.SetAttribute("FecN", UintegerValue(fecN));
+    mobileNodeHelper.SetAttribute("SignRequests", BooleanValue(sign));
+    ApplicationContainer mobileApps = mobileNodeHelper.Install(mobileNodes.Get(i));
+    mobileApps.Start(MilliSeconds(1000 + i % 1000)); // do not start all sessions in the same instant
+    allMobileApps.Add(mobileApps);
+  }
+
+  double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+
+  Simulator::Stop(Seconds(stopTime));
+
+  auto runStart = std::chrono::steady_clock::now();
+  Simulator::Run();
+  double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+  Ptr<ndn::KiteUploadServer> serverApp = DynamicCast<ndn::KiteUploadServer>(serverApps.Get(0));
+  std::cout << "mobiles: " << mobileSize
+            << ", sessions: " << serverApp->GetSessionCount()
+            << ", completed: " << serverApp->GetCompletedSessionCount()
+            << ", segments received: " << serverApp->GetReceivedSegmentCount() << std::endl;
+  std::cout << "retransmissions: " << serverApp->GetRetransmissionCount()
+            << ", spurious: " << serverApp->GetSpuriousRetransmissionCount()
+            << ", late data: " << serverApp->GetLateDataCount()
+            << ", rtt resets: " << serverApp->GetRttResetCount()
+            << ", resumes: " << serverApp->GetResumeCount()
+            << ", duplicate bytes: " << serverApp->GetDuplicateBytes() << std::endl;
+  if (fecK > 0) {
+    std::cout << "decoded groups: " << serverApp->GetDecodedGroupCount()
+              << ", repair segments: " << serverApp->GetRepairCount() << std::endl;
+  }
+  if (sign) {
+    std::cout << "verifications: " << serverApp->GetVerificationCount()
+              << ", cache hits: " << serverApp->GetVerificationCacheHitCount()
+              << ", rejected: " << serverApp->GetRejectedRequestCount() << std::endl;
+  }
+
+  uint64_t cacheHits = 0;
+  uint64_t cacheMisses = 0;
+  uint64_t servedBytes = 0;
+  for (auto app = allMobileApps.Begin(); app != allMobileApps.End(); ++app) {
+    Ptr<ndn::KiteUploadMobile> mobileApp = DynamicCast<ndn::KiteUploadMobile>(*app);
+    cacheHits += mobileApp->GetCacheHitCount();
+    cacheMisses += mobileApp->GetCacheMissCount();
+    servedBytes += mobileApp->GetServedBytes();
+  }
+  std::cout << "mobile packet cache hits: " << cacheHits << ", misses: " << cacheMisses
+            << ", bytes served: " << servedBytes << std::endl;
+
+  // trace bursts seen by the access routers, in 10 ms windows
+  uint32_t maxBurst = 0;
+  uint64_t nTraces = 0;
+  uint64_t nBusyWindows = 0;
+  for (int i = 0; i < accessSize; ++i) {
+    auto& strategy = dynamic_cast<nfd::fw::TraceForwardingStrategy&>(
+      accessRouters.Get(i)->GetObject<ndn::L3Protocol>()->getForwarder()->getStrategyChoice().findEffectiveStrategy("/"));
+    maxBurst = std::max(maxBurst, strategy.getMaxTracesPerWindow());
+    nTraces += strategy.getTraceCount();
+    for (const auto& bucket : strategy.getTracesPerWindowHistogram()) {
+      nBusyWindows += bucket.second;
+    }
+  }
+  std::cout << "access router traces: " << nTraces << ", max per 10 ms: " << maxBurst
+            << ", mean per busy 10 ms: " << (nBusyWindows > 0 ? double(nTraces) / nBusyWindows : 0) << std::endl;
+  std::cout << "setup wall time: " << setupSeconds << " s, run wall time: " << runSeconds << " s" << std::endl;
+
+  if (!metricsFile.empty()) {
+    ndn::KiteMetrics metrics;
+    metrics.Set("mobiles", mobileSize);
+    metrics.Set("sessions", serverApp->GetSessionCount());
+    metrics.Set("completedSessions", serverApp->GetCompletedSessionCount());
+    metrics.Set("receivedSegments", serverApp->GetReceivedSegmentCount());
+    metrics.Set("retransmissions", serverApp->GetRetransmissionCount());
+    metrics.Set("spuriousRetransmissions", serverApp->GetSpuriousRetransmissionCount());
+    metrics.Set("duplicateBytes", serverApp->GetDuplicateBytes());
+    metrics.Set("accessRouterTraces", nTraces);
+    metrics.Set("maxTracesPer10ms", maxBurst);
+    metrics.Set("setupSeconds", setupSeconds);
+    metrics.Set("runSeconds", runSeconds);
+    metrics.Save(metricsFile);
+  }
+
+  Simulator::Destroy();
+
+  return 0;
+}
+
+} // namespace ns3
+
+int
+main(int argc, char* argv[])
+{
+  return ns3::main(argc, argv);
+}
@@ -34,6 +34,24 @@
 #include "ndn-kite-upload-mobile.h"
 
 #include "trace-forwarding.h"
+#include "kite-cs-policy.h"
+#include "ndn-kite-wireless-face.h"
+#include "ndn-kite-p2p-face.h"
+#include "ndn-kite-priority-queue.h"
+#include "ndn-kite-topology.h"
+#include "ndn-kite-mobility-replayer.h"
+#include "ndn-kite-range-channel.h"
+#include "ndn-kite-contact-timeline.h"
+#include "ndn-kite-metrics.h"
+#include "ndn-kite-replicator.h"
+#include "ndn-kite-profiler.h"
+
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#include <mpi.h>
+#endif
+
+#include <chrono>
 
 using namespace std;
 namespace ns3 {
@@ -54,6 +72,52 @@ NS_LOG_COMPONENT_DEFINE("NdnPull");
 //   return face;
 // }
 
+// what contact links route while they are up
+struct ContactRouting
+{
+  NodeContainer mobileNodes;
+  NodeContainer accessRouters;
+  Name mobilePrefix;
+  bool isKite;
+};
+
+// a contact link came up or went down: only links in contact carry the mobile's Interests and, without
+// Kite, the access router's route to it. A link coming up is a new point of attachment
+static void
+OnContactLinkChange(const ContactRouting* routing, uint32_t mobile, uint32_t accessRouter,
+                    shared_ptr<ndn::Face> mobileFace, shared_ptr<ndn::Face> accessFace, bool isUp)
+{
+  Ptr<Node> node = routing->mobileNodes.Get(mobile);
+  if (isUp) {
+    ndn::FibHelper::AddRoute(node, "/", mobileFace, 1);
+    if (!routing->isKite) {
+      ndn::FibHelper::AddRoute(routing->accessRouters.Get(accessRouter), routing->mobilePrefix, accessFace, 1);
+    }
+    if (node->GetNApplications() > 0) {
+      DynamicCast<ndn::KiteUploadMobile>(node->GetApplication(0))->NotifyAttachmentChange();
+    }
+  }
+  else {
+    ndn::FibHelper::RemoveRoute(node, "/", mobileFace);
+    if (!routing->isKite) {
+      ndn::FibHelper::RemoveRoute(routing->accessRouters.Get(accessRouter), routing->mobilePrefix, accessFace);
+    }
+  }
+}
+
+// the nodes of one MPI rank
+static NodeContainer
+SelectSystem(const NodeContainer& nodes, uint32_t systemId)
+{
+  NodeContainer selected;
+  for (auto node = nodes.Begin(); node != nodes.End(); ++node) {
+    if ((*node)->GetSystemId() == systemId) {
+      selected.Add(*node);
+    }
+  }
+  return selected;
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -82,16 +146,87 @@ main(int argc, char* argv[])
   int speed = 20;
   int stopTime = 100;
   int joinTime = 1;
+  int prio = 0;
+  int aggregate = 0;
+  int kiteCs = 0;
+  int csWindow = 4;
+  int segmented = 0;
+  int segments = 100;
+  int traceOnMove = 0;
+  double cellSize = 0;
+  std::string topo = "grid";
+  int routerSize = 0;
+  int degree = 2;
+  double spacing = 40;
+  double accessDensity = 1.0;
+  std::string topoFile;
+  std::string saveTopo;
+  std::string mobilityTrace;
+  std::string wireless = "yans";
+  double range = 30;
+  int spatialIndex = 1;
+  std::string contacts;
+  std::string metricsFile;
+  std::string profileFile;
+  int replicas = 0;
+  int replicaJobs = 0;
+  std::string vary;
+  int mpi = 0;
 
   CommandLine cmd;
   cmd.AddValue("kite", "enable Kite", isKite);
   cmd.AddValue("speed", "mobile speed m/s", speed);
   cmd.AddValue("size", "# mobile", mobileSize);
-  cmd.AddValue("grid", "grid size", gridSize);  
+  cmd.AddValue("grid", "grid size, the backbone has grid * grid routers unless routers is set", gridSize);
+  cmd.AddValue("topo", "backbone topology: grid, tree or rgg", topo);
+  cmd.AddValue("routers", "# routers in the backbone", routerSize);
+  cmd.AddValue("degree", "tree degree", degree);
+  cmd.AddValue("spacing", "distance between neighbouring routers in meters", spacing);
+  cmd.AddValue("access", "fraction of the routers with wifi access", accessDensity);
+  cmd.AddValue("topoFile", "load the backbone from an annotated or binary topology file", topoFile);
+  cmd.AddValue("saveTopo", "save the backbone to a binary topology file", saveTopo);
+  cmd.AddValue("wireless", "wireless model: yans, or range for the PHY-less range channel", wireless);
+  cmd.AddValue("range", "radio range in meters of the range channel", range);
+  cmd.AddValue("spatialIndex", "let the range channel only check receivers in nearby cells", spatialIndex);
+  cmd.AddValue("contacts", "drive point-to-point access links from a contact file of kite-contacts", contacts);
+  cmd.AddValue("metrics", "write the results of the run to this JSON file", metricsFile);
+  cmd.AddValue("profile", "write where the wall time and memory of the run go to this JSON file", profileFile);
+  cmd.AddValue("replicas", "build once, then fork this many runs from RngRun on", replicas);
+  cmd.AddValue("replicaJobs", "replicas running at the same time, 0 for all cores", replicaJobs);
+  cmd.AddValue("vary", "replicate over attribute values too: path=value,value;path=value,value", vary);
+  cmd.AddValue("mpi", "run distributed, one rank per part of the backbone (set by ./waf --mpi)", mpi);
+  cmd.AddValue("mobilityTrace", "replay an ns-2 or ns-3 mobility trace instead of random walks", mobilityTrace);
   cmd.AddValue("stop", "stop time", stopTime);  
   cmd.AddValue("join", "join period", joinTime);  
+  cmd.AddValue("prio", "serve trace Interests before bulk data on p2p links", prio);
+  cmd.AddValue("aggregate", "trace aggregation prefix length, 0 to disable", aggregate);
+  cmd.AddValue("kiteCs", "use the Kite-aware CS policy on routers", kiteCs);
+  cmd.AddValue("csWindow", "seconds upload segments stay protected in CS", csWindow);
+  cmd.AddValue("segmented", "pull upload segments with a window of tracing Interests", segmented);
+  cmd.AddValue("segments", "# 1024-byte segments each mobile uploads with segmented", segments);
+  cmd.AddValue("traceOnMove", "send traces on attachment changes plus a keepalive", traceOnMove);
+  cmd.AddValue("cell", "side in meters of the cells whose crossing triggers a trace", cellSize);
   cmd.Parse (argc, argv);
 
+  nfd::fw::TraceForwardingStrategy::setTraceAggregationPrefixLength(aggregate);
+
+  // ranks build the whole scenario, but only simulate the nodes of their part
+  uint32_t systemId = 0;
+  uint32_t systemCount = 1;
+  if (mpi) {
+#ifdef NS3_MPI
+    if (replicas > 0 || !vary.empty()) {
+      NS_FATAL_ERROR("Replicas cannot be forked from a distributed run");
+    }
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(&argc, &argv);
+    systemId = MpiInterface::GetSystemId();
+    systemCount = MpiInterface::GetSize();
+#else
+    NS_FATAL_ERROR("Built without MPI, configure against an ns-3 with the mpi module");
+#endif
+  }
+
   //////////////////////
   //////////////////////
   //////////////////////
@@ -131,163 +266,334 @@ main(int argc, char* argv[])
 
   // wifi.Install( wifiPhy, wifiMac, wifiNodes.GetGlobal());
   
-  // make it move
-  Ptr<RandomRectanglePositionAllocator> positionAlloc = CreateObject<RandomRectanglePositionAllocator> ();
-  Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
-  x->SetAttribute ("Min", DoubleValue (10));
-  x->SetAttribute ("Max", DoubleValue (30));
-  positionAlloc->SetX (x);
-  positionAlloc->SetY (x);
-
-  MobilityHelper mobility;
-  mobility.SetPositionAllocator(positionAlloc);
-  std::stringstream ss;
-  ss << "ns3::UniformRandomVariable[Min=" << speed << "|Max=" << speed << "]";
-
-  mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-    "Bounds", RectangleValue (Rectangle (0, 40, -30, 30)),
-    "Distance", DoubleValue (60),
-    "Speed", StringValue (ss.str ()));
+  auto setupStart = std::chrono::steady_clock::now();
 
   // prefixes
-  std::string serverPrefix = "/server/upload";
-  std::string mobilePrefix = "/mobile/file";
+  std::string serverPrefix = "/server";
+  std::string mobilePrefix = "/mobile";
 
-  // gen nodes, a p2p grid, maybe faulty
-  /*PointToPointHelper p2p;
-  PointToPointGridHelper grid (gridSize, gridSize, p2p);
-  grid.BoundingBox(0,0,400,400);*/// Creating nodes
-  NodeContainer nodes;
-  nodes.Create(4);
-
-  // Connecting nodes using two links
+  // gen nodes: a backbone of routers, the server behind router 0, wifi on the access routers
   PointToPointHelper p2p;
-  p2p.Install(nodes.Get(0), nodes.Get(1));
-  p2p.Install(nodes.Get(1), nodes.Get(2));
-  p2p.Install(nodes.Get(1), nodes.Get(3));
-
+  if (prio) {
+    p2p.SetQueue("ns3::ndn::KitePriorityQueue", "MaxPacketsPerBand", UintegerValue(10),
+                 "MaxPackets", UintegerValue(10 * ndn::KitePriorityQueue::BAND_MAX));
+  }
 
-  NodeContainer wifiNodes;
-  NodeContainer mobileNodes;
-  mobileNodes.Create (mobileSize);
+  ndn::KiteTopologyBuilder topology;
+  topology.SetTopology(topo);
+  topology.SetRouterCount(routerSize > 0 ? routerSize : gridSize * gridSize);
+  topology.SetTreeDegree(degree);
+  topology.SetSpacing(spacing);
+  topology.SetAccessDensity(accessDensity);
+  topology.SetSystemCount(systemCount);
+  if (!topoFile.empty()) {
+    topology.Load(topoFile);
+  }
+  topology.Build(p2p);
+  if (!saveTopo.empty() && systemId == 0) {
+    topology.Save(saveTopo);
+  }
+  NodeContainer routers = topology.GetRouters();
 
-  // make mobile nodes mobile
-  mobility.Install (mobileNodes);
+  // each mobile lives on the rank of the access router it starts at
+  NodeContainer mobileNodes = topology.CreateMobiles(mobileSize);
 
-  // install wifi
-  //NS_LOG_INFO(wifiNodes.GetGlobal());
+  // make mobile nodes mobile, replaying a recorded trace if there is one
+  Ptr<ndn::KiteMobilityReplayer> replayer;
+  if (mobilityTrace.empty()) {
+    topology.InstallMobility(mobileNodes, speed);
+  }
+  else {
+    replayer = CreateObject<ndn::KiteMobilityReplayer>();
+    replayer->Install(mobilityTrace, mobileNodes);
+  }
 
-  //wifi.Install (wifiPhy, wifiMac, nodes.GetGlobal());
-  wifi.Install (wifiPhy, wifiMac, nodes.Get(2));
-  wifi.Install (wifiPhy, wifiMac, nodes.Get(3));
-  wifi.Install (wifiPhy, wifiMac, mobileNodes.Get(0));
+  // install wifi, the range channel that skips the PHY, or links following precomputed contacts.
+  // Every rank has its own wireless island: a channel with its access routers and mobiles, which
+  // walk only the bounding box of the island, see KiteTopologyBuilder::InstallMobility()
+  Ptr<ndn::KiteRangeChannel> rangeChannel;
+  ndn::KiteContactTimeline contactTimeline;
+  ApplicationContainer mobileApps;
+  NetDeviceContainer wifiDevices;
+  if (!contacts.empty()) {
+    contactTimeline.Load(contacts); // links are created as contacts begin
+  }
+  else if (wireless == "range") {
+    ndn::KiteRangeHelper rangeHelper;
+    rangeHelper.SetChannelAttribute("Range", DoubleValue(range));
+    rangeHelper.SetChannelAttribute("SpatialIndex", BooleanValue(spatialIndex != 0));
+    for (uint32_t i = 0; i < systemCount; ++i) {
+      Ptr<ndn::KiteRangeChannel> channel = rangeHelper.CreateChannel();
+      rangeHelper.Install(SelectSystem(topology.GetAccessRouters(), i), channel);
+      rangeHelper.Install(SelectSystem(mobileNodes, i), channel);
+      if (i == systemId) {
+        rangeChannel = channel;
+      }
+    }
+  }
+  else {
+    for (uint32_t i = 0; i < systemCount; ++i) {
+      if (i > 0) {
+        wifiPhy.SetChannel (wifiChannel.Create ());
+      }
+      wifiDevices.Add(wifi.Install (wifiPhy, wifiMac, SelectSystem(topology.GetAccessRouters(), i)));
+      wifiDevices.Add(wifi.Install (wifiPhy, wifiMac, SelectSystem(mobileNodes, i)));
+    }
+  }
 
-  // Install NDN stack on all nodes
+  // Install NDN stack on all nodes, routers get their routes from the topology builder
   ndn::StackHelper ndnHelper;
+  // wifi faces share one ad-hoc channel, let the strategy see them as multi-access
+  ndn::StackHelper::FaceCreateCallback wirelessFace = MakeCallback(&ndn::KiteWirelessFaceCallback);
+  ndn::StackHelper::FaceCreateCallback p2pFace = MakeCallback(&ndn::KitePointToPointFaceCallback);
+  // the profiler times NFD on its own, so its faces have to be created through it
+  Ptr<ndn::KiteProfiler> profiler;
+  if (!profileFile.empty()) {
+    profiler = CreateObject<ndn::KiteProfiler>();
+    wirelessFace = profiler->TimeFaces(wirelessFace);
+    p2pFace = profiler->TimeFaces(p2pFace);
+    ndnHelper.UpdateFaceCreateCallback(PointToPointNetDevice::GetTypeId(), p2pFace);
+  }
+  ndnHelper.AddFaceCreateCallback(WifiNetDevice::GetTypeId(), wirelessFace);
+  ndnHelper.AddFaceCreateCallback(ndn::KiteRangeNetDevice::GetTypeId(), wirelessFace);
+  ndnHelper.Install(topology.GetServer());
+  ndnHelper.Install(routers);
   ndnHelper.SetDefaultRoutes(true);
-  ndnHelper.InstallAll();
-  // install separately
-  // ndnHelper.InstallAll();
-
-  // Set BestRoute strategy
-  // ndn::StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/best-route");
-  // multicat strategy
-  // ndn::StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/multicast");
-  // pit forwarding strategy
-
-  //Ptr<Node> serverNode = nodes.Get(0);
-
-  //ndn::StrategyChoiceHelper::InstallAll<nfd::fw::TraceForwardingStrategy>("/");
-  ndn::StrategyChoiceHelper::Install(nodes.Get(2), "/", "nfd::fw::TraceForwardingStrategy");
-  ndn::StrategyChoiceHelper::Install(nodes.Get(3), "/", "nfd::fw::TraceForwardingStrategy");
-  ndn::StrategyChoiceHelper::Install(nodes.Get(1), "/", "nfd::fw::TraceForwardingStrategy");
-  // Installing applications
-
-  // Stationary server
-  ndn::AppHelper serverHelper("ns3::ndn::KiteUploadServer");
-  serverHelper.SetPrefix("/mobile");
-  serverHelper.SetAttribute("ServerPrefix", StringValue("/server"));
-  serverHelper.Install(nodes.Get(0));                        // first node
+  ndnHelper.Install(mobileNodes);
+
+  // keep pulled upload segments on the routers of the trace path
+  if (kiteCs) {
+    for (uint32_t i = 0; i < routers.GetN(); ++i) {
+      std::unique_ptr<nfd::cs::KitePolicy> policy(new nfd::cs::KitePolicy());
+      policy->addUploadPrefix(mobilePrefix);
+      policy->setProtectionWindow(::ndn::time::seconds(csWindow));
+      routers.Get(i)->GetObject<ndn::L3Protocol>()->getForwarder()->getCs().setPolicy(std::move(policy));
+    }
+  }
 
-  // Mobile node
-  ndn::AppHelper mobileNodeHelper("ns3::ndn::KiteUploadMobile");
-  mobileNodeHelper.SetPrefix("/mobile");
-  mobileNodeHelper.SetAttribute("ServerPrefix", StringValue("/server"));
-  mobileNodeHelper.SetAttribute("MobilePrefix", StringValue("/mobile"));
-  mobileNodeHelper.SetAttribute("PayloadSize", StringValue("1024"));
-  mobileNodeHelper.Install(mobileNodes); // last node
+  // TraceForwardingStrategy with Kite, multicast plus routes towards the mobiles without
+  topology.InstallStrategy(isKite != 0);
+  topology.InstallRoutes(serverPrefix, mobilePrefix, isKite != 0);
+  ContactRouting contactRouting{mobileNodes, topology.GetAccessRouters(), mobilePrefix, isKite != 0};
+  if (!contacts.empty()) {
+    // mobiles send on all the links in contact, OnContactLinkChange keeps only those in their FIB
+    ndn::StrategyChoiceHelper::Install(mobileNodes, "/", "/localhost/nfd/strategy/multicast");
+    PointToPointHelper contactP2p;
+    contactP2p.SetDeviceAttribute("DataRate", StringValue("24Mbps"));
+    contactP2p.SetChannelAttribute("Delay", StringValue("1ms"));
+    contactTimeline.InstallLinks(mobileNodes, topology.GetAccessRouters(), contactP2p, p2pFace,
+                                 MakeBoundCallback(&OnContactLinkChange, &contactRouting));
+  }
 
+  // Installing applications
 
-  ndn::FibHelper::AddRoute (nodes.Get(3), "/", nodes.Get(1), 1);
-  ndn::FibHelper::AddRoute (nodes.Get(2), "/", nodes.Get(1), 1);
-  ndn::FibHelper::AddRoute (nodes.Get(1), "/", nodes.Get(0), 1);
+  // Stationary server, next to router 0 on rank 0
+  bool hasServer = topology.GetServer()->GetSystemId() == systemId;
+  if (hasServer) {
+    ndn::AppHelper serverHelper("ns3::ndn::KiteUploadServer");
+    serverHelper.SetPrefix(mobilePrefix);
+    serverHelper.SetAttribute("ServerPrefix", StringValue(serverPrefix));
+    serverHelper.SetAttribute("SegmentedUpload", BooleanValue(segmented != 0));
+    if (segmented) {
+      serverHelper.SetAttribute("MaxSeq", IntegerValue(segments));
+    }
+    serverHelper.Install(topology.GetServer());
+  }
 
-  //Ptr<Node> userNode = grid.GetNode(gridSize - 1, gridSize - 1);
-  
-  /*Ptr<ndn::FaceContainer> faces = ndnHelper.Install (mobileNodes);
-  for (uint32_t i = 0;
-       i != faces->GetN();
-       i++)
-  {
-    std::shared_ptr<ndn::Face> face = faces->Get(i);
-    ndn::FibHelper::AddRoute (//face->GetNode ()
-    mobileNodes.Get(0), serverPrefix, face, 1);
-  }*/
-
-
-  /*for (int i = 0; i<gridSize; i++)
-  {
-    for (int j = 0; j<gridSize; j++)
-    {
-        ndnHelper.Install (grid.GetNode (i, j));
-        if (i ==0 && j==0) continue;
-        int m = i>j ? (i - 1) : i;
-        int n = i>j ? j : (j - 1);
-        ndn::FibHelper::AddRoute (grid.GetNode (i, j), serverPrefix, grid.GetNode (m, n), 1);
+  // Mobile nodes of this rank, each under its own prefix, joining over the join period
+  for (uint32_t i = 0; i < mobileNodes.GetN(); ++i) {
+    if (mobileNodes.Get(i)->GetSystemId() != systemId) {
+      continue;
     }
+    std::string prefix = mobileSize > 1 ? mobilePrefix + "/" + std::to_string(i) : mobilePrefix;
+    ndn::AppHelper mobileNodeHelper("ns3::ndn::KiteUploadMobile");
+    mobileNodeHelper.SetPrefix(prefix);
+    mobileNodeHelper.SetAttribute("ServerPrefix", StringValue(serverPrefix));
+    mobileNodeHelper.SetAttribute("MobilePrefix", StringValue(prefix));
+    mobileNodeHelper.SetAttribute("PayloadSize", StringValue("1024"));
+    if (segmented) {
+      mobileNodeHelper.SetAttribute("ObjectSize", UintegerValue(segments * 1024));
+    }
+    mobileNodeHelper.SetAttribute("TraceOnMove", BooleanValue(traceOnMove != 0));
+    mobileNodeHelper.SetAttribute("CellSize", DoubleValue(cellSize));
+    ApplicationContainer app = mobileNodeHelper.Install(mobileNodes.Get(i));
+    app.Start(Seconds(static_cast<double>(joinTime) * i / mobileNodes.GetN()));
+    mobileApps.Add(app);
   }
 
-  ndn::StrategyChoiceHelper::InstallAll<ndn::nfd::fw::TraceForwardingStrategy>("/");
+  Simulator::Stop(Seconds(stopTime));
 
-  // 4. Set up applications
-  NS_LOG_INFO("Installing Applications");
+  double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+  std::cout << "setup wall time: " << setupSeconds << " s for " << routers.GetN() << " routers" << std::endl;
 
-  ndn::AppHelper consumerHelper("ServerApp");
-  // ndn::AppHelper consumerHelper("ns3::ndn::ConsumerCbr");
-  // consumerHelper.SetPrefix(mobilePrefix);
-  // consumerHelper.SetAttribute("Frequency", StringValue("1"));
-  consumerHelper.Install(serverNode);
-  // ApplicationContainer consumerApp = consumerHelper.Install(rpNode);
-  // consumerApp.Start(Seconds(0));
+  // fork the replicas off the built scenario, each redraws the random streams set up under the first run
+  ndn::KiteReplicator replicator;
+  bool isReplica = replicas > 0 || !vary.empty();
+  if (isReplica) {
+    replicator.SetRuns(RngSeedManager::GetRun(), std::max(replicas, 1));
+    if (replicaJobs > 0) {
+      replicator.SetJobs(replicaJobs);
+    }
+    replicator.Vary(vary);
+    if (!replicator.Fork()) {
+      std::cout << replicator.GetReplicaCount() << " replicas of one setup, " << replicator.GetFailedCount()
+                << " failed" << std::endl;
+      Simulator::Destroy();
+      return replicator.GetFailedCount() == 0 ? 0 : 1;
+    }
 
-  ndn::AppHelper producerHelper("MobileApp");
-  // ndn::AppHelper producerHelper("ns3::ndn::Producer");
-  // producerHelper.SetPrefix(mobilePrefix);
-  // producerHelper.SetAttribute("PayloadSize", StringValue("1200"));
-  // producerHelper.Install(userNode);
-  producerHelper.Install(mobileNodes);
-  // ApplicationContainer producerApp = producerHelper.Install(mobileNode);
-  // producerApp.Start(Seconds(1));
+    int64_t stream = 0;
+    MobilityHelper mobility;
+    stream += mobility.AssignStreams(mobileNodes, stream);
+    stream += wifi.AssignStreams(wifiDevices, stream);
+    if (rangeChannel != nullptr) {
+      stream += rangeChannel->AssignStreams(stream);
+    }
+    for (auto app = mobileApps.Begin(); app != mobileApps.End(); ++app) {
+      stream += DynamicCast<ndn::KiteUploadMobile>(*app)->AssignStreams(stream);
+    }
+    if (!metricsFile.empty()) {
+      metricsFile = replicator.GetFileName(metricsFile);
+    }
+    if (!profileFile.empty()) {
+      profileFile = replicator.GetFileName(profileFile);
+    }
+  }
 
-  // Installing global routing interface on all nodes
-  // ndn::GlobalRoutingHelper ndnGlobalRoutingHelper;
-  // ndnGlobalRoutingHelper.InstallAll();
+  // each rank profiles its own part of the simulation
+  ndn::KiteMetrics profile;
+  if (profiler != nullptr) {
+    if (systemCount > 1) {
+      profileFile += "." + std::to_string(systemId);
+    }
+    profiler->Start();
+  }
 
+  auto runStart = std::chrono::steady_clock::now();
+  Simulator::Run();
+  double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+  if (profiler != nullptr) {
+    profiler->AddTo(profile, SelectSystem(NodeContainer::GetGlobal(), systemId));
+    profile.Save(profileFile);
+  }
 
-  // Add /prefix origins to ndn::GlobalRouter
-  // ndnGlobalRoutingHelper.AddOrigins(serverPrefix, serverNode);
-  // ndnGlobalRoutingHelper.AddOrigins(mobilePrefix, mobileNodes);
-  // ndnGlobalRoutingHelper.AddOrigins(mobilePrefix, userNode);
+  uint64_t nTraces = 0;
+  uint64_t nMoveTraces = 0;
+  for (auto app = mobileApps.Begin(); app != mobileApps.End(); ++app) {
+    Ptr<ndn::KiteUploadMobile> mobileApp = DynamicCast<ndn::KiteUploadMobile>(*app);
+    std::cout << "mobile " << mobileApp->GetNode()->GetId() << ": traces " << mobileApp->GetTraceCount()
+              << ", on move " << mobileApp->GetMoveTraceCount() << std::endl;
+    nTraces += mobileApp->GetTraceCount();
+    nMoveTraces += mobileApp->GetMoveTraceCount();
+  }
+  uint64_t nCsInserts = 0;
+  uint64_t nCsHits = 0;
+  uint64_t nCsDemoted = 0;
+  if (kiteCs) {
+    for (uint32_t i = 0; i < routers.GetN(); ++i) {
+      auto policy = dynamic_cast<nfd::cs::KitePolicy*>(
+        routers.Get(i)->GetObject<ndn::L3Protocol>()->getForwarder()->getCs().getPolicy());
+      nCsInserts += policy->getUploadInsertCount();
+      nCsHits += policy->getUploadHitCount();
+      nCsDemoted += policy->getDemotedCount();
+    }
+  }
+#ifdef NS3_MPI
+  if (systemCount > 1) {
+    // the mobiles and routers are spread over the ranks, the totals go to the server's
+    unsigned long long local[] = {nTraces, nMoveTraces, nCsInserts, nCsHits, nCsDemoted};
+    unsigned long long total[] = {0, 0, 0, 0, 0};
+    MPI_Reduce(local, total, 5, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    nTraces = total[0];
+    nMoveTraces = total[1];
+    nCsInserts = total[2];
+    nCsHits = total[3];
+    nCsDemoted = total[4];
+  }
+#endif
+  if (kiteCs) {
+    std::cout << "router CS upload segments admitted: " << nCsInserts << ", hits: " << nCsHits
+              << ", demoted: " << nCsDemoted << std::endl;
+  }
+  if (replayer != nullptr) {
+    std::cout << "course changes replayed: " << replayer->GetReplayedCount() << ", late: " << replayer->GetLateCount()
+              << ", max pending: " << replayer->GetMaxPendingCount() << std::endl;
+  }
+  if (!contacts.empty()) {
+    std::cout << "contact links: " << contactTimeline.GetLinkCount() << " for "
+              << contactTimeline.GetContacts().size() << " contacts" << std::endl;
+  }
+  if (rangeChannel != nullptr) {
+    std::cout << "range channel frames: " << rangeChannel->GetFrameCount()
+              << ", receivers checked per frame: "
+              << static_cast<double>(rangeChannel->GetCandidateCount()) / std::max<uint64_t>(rangeChannel->GetFrameCount(), 1)
+              << std::endl;
+  }
+  std::cout << "run wall time (" << wireless << "): " << runSeconds << " s";
+  if (isReplica) {
+    std::cout << ", replica " << replicator.GetReplica() << " (run " << replicator.GetRun() << ")";
+  }
+  if (systemCount > 1) {
+    std::cout << ", rank " << systemId << " of " << systemCount;
+  }
+  std::cout << std::endl;
+  if (profiler != nullptr) {
+    std::cout << "events: " << profiler->GetEventCount() << ", per wall second: " << profiler->GetEventRate()
+              << ", peak RSS: " << ndn::KiteProfiler::GetPeakRss() << " KiB, NFD received "
+              << profiler->GetForwardedCount() << " packets" << std::endl;
+    // every wifi frame reaches NFD through a timed face, none timed means the probes missed the transport
+    if (wifiDevices.GetN() > 0 && profiler->GetForwardedCount() == 0) {
+      NS_FATAL_ERROR("The profiler timed no NFD processing on wifi");
+    }
+  }
 
-  // Calculate and install FIBs
-  // ndn::GlobalRoutingHelper::CalculateRoutes();
+  Ptr<ndn::KiteUploadServer> serverApp;
+  if (hasServer) {
+    serverApp = DynamicCast<ndn::KiteUploadServer>(topology.GetServer()->GetApplication(0));
+    std::cout << "sessions: " << serverApp->GetSessionCount() << ", completed: " << serverApp->GetCompletedSessionCount()
+              << ", segments: " << serverApp->GetReceivedSegmentCount()
+              << ", retransmissions: " << serverApp->GetRetransmissionCount() << std::endl;
+  }
 
-  ////////////////
-*/
-  Simulator::Stop(Seconds(20.0));
+  if (!metricsFile.empty() && hasServer) {
+    ndn::KiteMetrics metrics;
+    metrics.Set("mobiles", mobileSize);
+    metrics.Set("routers", routers.GetN());
+    metrics.Set("accessRouters", topology.GetAccessRouters().GetN());
+    metrics.Set("systems", systemCount);
+    metrics.Set("sessions", serverApp->GetSessionCount());
+    metrics.Set("completedSessions", serverApp->GetCompletedSessionCount());
+    metrics.Set("receivedSegments", serverApp->GetReceivedSegmentCount());
+    metrics.Set("retransmissions", serverApp->GetRetransmissionCount());
+    metrics.Set("traces", nTraces);
+    metrics.Set("moveTraces", nMoveTraces);
+    if (kiteCs) {
+      metrics.Set("csUploadInserts", nCsInserts);
+      metrics.Set("csUploadHits", nCsHits);
+      metrics.Set("csDemoted", nCsDemoted);
+    }
+    metrics.Set("setupSeconds", setupSeconds);
+    metrics.Set("runSeconds", runSeconds);
+    if (profiler != nullptr) {
+      metrics.Set("eventsPerSecond", profiler->GetEventRate());
+      metrics.Set("peakRssKiB", ndn::KiteProfiler::GetPeakRss());
+    }
+    if (isReplica) {
+      metrics.Set("replica", replicator.GetReplica());
+      metrics.Set("run", replicator.GetRun());
+      for (const auto& value : replicator.GetValues()) {
+        metrics.Set(value.first, value.second);
+      }
+    }
+    metrics.Save(metricsFile);
+  }
 
-  Simulator::Run();
   Simulator::Destroy();
+#ifdef NS3_MPI
+  if (mpi) {
+    MpiInterface::Disable();
+  }
+#endif
 
   return 0;
 }
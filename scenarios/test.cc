@@ -22,6 +22,9 @@
 #include "ndn-kite-upload-mobile.h"
 
 #include "trace-forwarding.h"
+#include "ndn-kite-wireless-face.h"
+#include "ndn-kite-priority-queue.h"
+#include "ndn-kite-topology.h"
 
 namespace ns3 {
 
@@ -64,98 +67,47 @@ main(int argc, char* argv[])
 	int speed = 100;
 	int stopTime = 100;
 	int joinTime = 1;
+	int prio = 0;
+	std::string topo = "grid";
+	int routerSize = 0;
+	double accessDensity = 1.0;
 
 	CommandLine cmd;
 	cmd.AddValue("kite", "enable Kite", isKite);
 	cmd.AddValue("speed", "mobile speed m/s", speed);
 	cmd.AddValue("size", "# mobile", mobileSize);
-	cmd.AddValue("grid", "grid size", gridSize);  
+	cmd.AddValue("grid", "grid size, the backbone has grid * grid routers unless routers is set", gridSize);
+	cmd.AddValue("topo", "backbone topology: grid, tree or rgg", topo);
+	cmd.AddValue("routers", "# routers in the backbone", routerSize);
+	cmd.AddValue("access", "fraction of the routers with wifi access", accessDensity);
 	cmd.AddValue("stop", "stop time", stopTime);  
 	cmd.AddValue("join", "join period", joinTime);  
+	cmd.AddValue("prio", "serve trace Interests before bulk data on p2p links", prio);
 	cmd.Parse (argc, argv);
 
-	//set stationary nodes
-	NodeContainer nodes;
-	nodes.Create(4);
-
-	MobilityHelper mobility;
-	Ptr<ListPositionAllocator> posAlloc = CreateObject<ListPositionAllocator> ();
-	posAlloc->Add (Vector (0.0, 0.0, 0.0));
-	posAlloc->Add (Vector (100.0, 0.0, 0.0));
-	posAlloc->Add (Vector (200.0, 100.0, 0.0));
-	posAlloc->Add (Vector (200.0, -100.0, 0.0));
-	mobility.SetPositionAllocator (posAlloc);
-	mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-	mobility.Install (nodes);
+	std::string serverPrefix = "/server";
+	std::string mobilePrefix = "/mobile";
 
+	//set stationary nodes: grid * grid routers 100m apart, the server behind router 0
 	PointToPointHelper p2p;
-	p2p.Install(nodes.Get(0), nodes.Get(1));
-	p2p.Install(nodes.Get(1), nodes.Get(2));
-	p2p.Install(nodes.Get(1), nodes.Get(3));
-
-	/*
-	//set mobile-nodes
-	Ptr<RandomRectanglePositionAllocator> positionAlloc = CreateObject<RandomRectanglePositionAllocator> ();
-	Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
-	x->SetAttribute ("Min", DoubleValue (150));
-	x->SetAttribute ("Max", DoubleValue (250));
-	positionAlloc->SetX (x);
-	x->SetAttribute ("Min", DoubleValue (-100));
-	x->SetAttribute ("Max", DoubleValue (100));
-	positionAlloc->SetY (x);
-
-	MobilityHelper a_mobility;
-	// a_mobility.SetPositionAllocator(positionAlloc);
-	// std::stringstream ss;
-	// ss << "ns3::UniformRandomVariable[Min=" << speed << "|Max=" << speed << "]";
-
-	// a_mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-	// 	"Bounds", RectangleValue (Rectangle (150, 250, -100, 100)),
-	// 	"Distance", DoubleValue (200),
-	// 	"Speed", StringValue (ss.str ()));
-
-	
-
-	NodeContainer mobileNodes;
-	mobileNodes.Create (mobileSize);
-	// make mobile nodes mobile
-	a_mobility.Install (mobileNodes);
-
-
-	posAlloc = CreateObject<ListPositionAllocator> ();
-	posAlloc->Add (Vector (200.0, 80.0, 0.0));
-	mobility.SetPositionAllocator (posAlloc);
-	mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-	mobility.Install (mobileNodes);
-	*/
-
-	//set mobile-nodes
-	Ptr<RandomRectanglePositionAllocator> positionAlloc = CreateObject<RandomRectanglePositionAllocator> ();
-	Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
-	x->SetAttribute ("Min", DoubleValue (150));
-	x->SetAttribute ("Max", DoubleValue (250));
-	positionAlloc->SetX (x);
-	x->SetAttribute ("Min", DoubleValue (0));
-	x->SetAttribute ("Max", DoubleValue (100));
-	positionAlloc->SetY (x);
-
-	MobilityHelper a_mobility;
-	a_mobility.SetPositionAllocator(positionAlloc);
-	std::stringstream ss;
-	ss << "ns3::UniformRandomVariable[Min=" << speed << "|Max=" << speed << "]";
-
-	a_mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-		"Bounds", RectangleValue (Rectangle (249, 250, -100, 100)),
-		"Distance", DoubleValue (200),
-		"Speed", StringValue (ss.str ()));
-
+	if (prio) {
+		p2p.SetQueue("ns3::ndn::KitePriorityQueue", "MaxPacketsPerBand", UintegerValue(10),
+		             "MaxPackets", UintegerValue(10 * ndn::KitePriorityQueue::BAND_MAX));
+	}
+
+	ndn::KiteTopologyBuilder topology;
+	topology.SetTopology(topo);
+	topology.SetRouterCount(routerSize > 0 ? routerSize : gridSize * gridSize);
+	topology.SetSpacing(100);
+	topology.SetAccessDensity(accessDensity);
+	topology.Build(p2p);
+
+	//set mobile-nodes around the access routers
 	NodeContainer mobileNodes;
 	mobileNodes.Create (mobileSize);
-	// make mobility move
-	a_mobility.Install (mobileNodes);
+	topology.InstallMobility(mobileNodes, speed);
 
-
-	//apply wifi component on mobile-nodes and constant-nodes
+	//apply wifi component on mobile-nodes and access routers
 	WifiHelper wifi;
 	wifi.SetStandard (WIFI_PHY_STANDARD_80211a);
 	// Set to a non-QoS upper mac
@@ -174,63 +126,40 @@ main(int argc, char* argv[])
 	wifiChannel.AddPropagationLoss ("ns3::LogDistancePropagationLossModel", "Exponent", DoubleValue (3.0));
 	wifiPhy.SetChannel (wifiChannel.Create ());
 	wifi.Install (wifiPhy, wifiMac, mobileNodes);
-	wifi.Install (wifiPhy, wifiMac, nodes.Get(2));
-	wifi.Install (wifiPhy, wifiMac, nodes.Get(3));
-
-	//a previous way to install wifi nodes
-	/*YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
-	YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-	wifiPhy.SetChannel (wifiChannel.Create ());
-	wifiPhy.Set ("TxPowerStart",DoubleValue(5));
-	wifiPhy.Set ("TxPowerEnd",DoubleValue(5));
-	wifiPhy.Set ("TxPowerLevels",UintegerValue (1));
-	wifiPhy.Set ("TxGain",DoubleValue (1));
-	wifiPhy.Set ("RxGain",DoubleValue (1));
-
-	WifiHelper wifi = WifiHelper::Default ();
-	NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
-	wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
-	wifiMac.SetType("ns3::AdhocWifiMac");
-
-	wifi.Install (wifiPhy, wifiMac, mobileNodes);
-	wifi.Install (wifiPhy, wifiMac, nodes.Get(2));
-	wifi.Install (wifiPhy, wifiMac, nodes.Get(3));
-
-	ndn::StackHelper ndnHelper;
-	ndnHelper.SetDefaultRoutes(true);
-	ndnHelper.InstallAll();*/
+	wifi.Install (wifiPhy, wifiMac, topology.GetAccessRouters());
 
 	ndn::StackHelper ndnHelper;
+	// wifi faces share one ad-hoc channel, let the strategy see them as multi-access
+	ndnHelper.AddFaceCreateCallback(WifiNetDevice::GetTypeId(), MakeCallback(&ndn::KiteWirelessFaceCallback));
+	ndnHelper.Install(topology.GetServer());
+	ndnHelper.Install(topology.GetRouters());
 	ndnHelper.SetDefaultRoutes(true);
-	ndnHelper.InstallAll();
-
-	//ndn::StrategyChoiceHelper::InstallAll<nfd::fw::TraceForwardingStrategy>("/");
-	ndn::StrategyChoiceHelper::Install<nfd::fw::TraceForwardingStrategy>(nodes.Get(1), "/");
-	ndn::StrategyChoiceHelper::Install<nfd::fw::TraceForwardingStrategy>(nodes.Get(2), "/");
-	ndn::StrategyChoiceHelper::Install<nfd::fw::TraceForwardingStrategy>(nodes.Get(3), "/");
-
+	ndnHelper.Install(mobileNodes);
 
-	// ndn::FibHelper::AddRoute (nodes.Get(1), serverPrefix, nodes.Get(0), 1);
-	// ndn::FibHelper::AddRoute (nodes.Get(1), MobilePrefix, nodes.Get(2), 1);
-	// ndn::FibHelper::AddRoute (nodes.Get(1), MobilePrefix, nodes.Get(3), 1);
+	topology.InstallStrategy(isKite != 0);
+	topology.InstallRoutes(serverPrefix, mobilePrefix, isKite != 0);
 
 	// Installing applications
 
-		// Stationary server
+	// Stationary server
 	ndn::AppHelper serverHelper("ns3::ndn::KiteUploadServer");
-	serverHelper.SetPrefix("/mobile");
-	serverHelper.SetAttribute("ServerPrefix", StringValue("/server"));
-	serverHelper.Install(nodes.Get(0));                        // first node
-
-	// Mobile node
-	ndn::AppHelper mobileNodeHelper("ns3::ndn::KiteUploadMobile");
-	mobileNodeHelper.SetPrefix("/mobile");
-	mobileNodeHelper.SetAttribute("ServerPrefix", StringValue("/server"));
-	mobileNodeHelper.SetAttribute("MobilePrefix", StringValue("/mobile"));
-	mobileNodeHelper.SetAttribute("PayloadSize", StringValue("1024"));
-	mobileNodeHelper.Install(mobileNodes.Get(0)); // last node
-
-	Simulator::Stop(Seconds(20.0));
+	serverHelper.SetPrefix(mobilePrefix);
+	serverHelper.SetAttribute("ServerPrefix", StringValue(serverPrefix));
+	serverHelper.Install(topology.GetServer());
+
+	// Mobile nodes, joining over the join period
+	for (uint32_t i = 0; i < mobileNodes.GetN(); ++i) {
+		std::string prefix = mobileSize > 1 ? mobilePrefix + "/" + std::to_string(i) : mobilePrefix;
+		ndn::AppHelper mobileNodeHelper("ns3::ndn::KiteUploadMobile");
+		mobileNodeHelper.SetPrefix(prefix);
+		mobileNodeHelper.SetAttribute("ServerPrefix", StringValue(serverPrefix));
+		mobileNodeHelper.SetAttribute("MobilePrefix", StringValue(prefix));
+		mobileNodeHelper.SetAttribute("PayloadSize", StringValue("1024"));
+		ApplicationContainer app = mobileNodeHelper.Install(mobileNodes.Get(i));
+		app.Start(Seconds(static_cast<double>(joinTime) * i / mobileNodes.GetN()));
+	}
+
+	Simulator::Stop(Seconds(stopTime));
 	Simulator::Run();
 	Simulator::Destroy();
 